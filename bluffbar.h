@@ -0,0 +1,72 @@
+/* 
+   bluffbar.h - C interface to the headless Bluff Bar engine.
+
+   Build as a shared library:
+     g++ -std=c++17 -O2 -pthread -fPIC -shared -fvisibility=hidden \
+         -Wl,--version-script=bluffbar.map -DBLUFFBAR_LIBRARY game.cpp -o libbluffbar.so
+
+   Only the bb_* functions below are exported (BB_API). -fvisibility=hidden
+   keeps the engine's own symbols internal, and bluffbar.map hides the
+   standard-library template instances it pulls in.
+
+   A runner is independent of every other runner (own config, own RNG),
+   so callers may create as many as they like. A single runner is not
+   thread-safe; use one runner per thread.
+    */
+#ifndef BLUFFBAR_H
+#define BLUFFBAR_H
+
+#include <stddef.h>
+
+#if defined(__GNUC__)
+#define BB_API __attribute__((visibility("default")))
+#else
+#define BB_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BB_OK      0
+#define BB_EINVAL -1   /* bad argument */
+#define BB_EFAIL  -2   /* engine error while running games */
+
+typedef struct bb_runner bb_runner;
+
+typedef struct bb_game_result {
+    int winner;        /* seat index, -1 if nobody survived */
+    int first_player;  /* seat that opened the game */
+    int rounds;
+    int questions;
+    int bombs;         /* bombs that exploded */
+} bb_game_result;
+
+/* Bot-only table with 4 seats and the standard rules. NULL on failure. */
+BB_API bb_runner* bb_runner_create(unsigned seed);
+
+/*
+   Setters return BB_EINVAL, leaving the runner unchanged, for settings
+   a game could never finish with: with 3 or more players alive only a
+   question ends a round, so 3 or 4 bots at 0% are rejected.
+ */
+BB_API int bb_runner_set_players(bb_runner* r, int num_bots);          /* 2..4 */
+BB_API int bb_runner_set_bomb_one_in(bb_runner* r, int n);              /* default 3 */
+BB_API int bb_runner_set_question_percent(bb_runner* r, int percent);   /* default 30 */
+
+/* Per-table memory budget in bytes, checked after every deal (0 = unlimited,
+   the default). A table over budget makes bb_runner_run return BB_EFAIL. */
+BB_API int bb_runner_set_memory_budget(bb_runner* r, size_t bytes);
+
+/* Plays n games, writing one result per game into results[0..n-1].
+   Each game has a step limit; a game that hits it, or any other engine
+   error, makes the call return BB_EFAIL instead of hanging. */
+BB_API int bb_runner_run(bb_runner* r, int n, bb_game_result* results);
+
+BB_API void bb_runner_free(bb_runner* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLUFFBAR_H */
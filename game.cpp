@@ -6,23 +6,94 @@
 #include <ctime>
 #include <limits>    // for numeric_limits
 #include <exception> // for std::exception
+#include <stdexcept> // for invalid_argument
 #include <unordered_map>
 #include <random>
+#include <deque>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <cstring>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "bluffbar.h"
 
 using namespace std;
 
 /* 
-   TEMPLATE: Deck<T>
+   Memory accounting helpers: heap bytes a value owns beyond its own
+   sizeof (capacity, not size, since that is what is allocated).
+    */
+template<typename U>
+inline size_t heapBytes(const U&) { return 0; }
+
+inline size_t heapBytes(const string& s) {
+    size_t inlineCapacity = string().capacity();   // small-string buffer
+    return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+template<typename U>
+inline size_t heapBytes(const vector<U>& v) {
+    size_t bytes = v.capacity() * sizeof(U);
+    for (const U& x : v) bytes += heapBytes(x);
+    return bytes;
+}
+
+/* 
+   StreamRng: splitmix64, one 64-bit word of state. A table runs four of
+   these (one per random stream); four mt19937 engines would be 20 KB of
+   the table. Meets UniformRandomBitGenerator, so the standard
+   distributions and std::shuffle take it directly.
+    */
+class StreamRng {
+private:
+    uint64_t state;
+
+public:
+    using result_type = uint64_t;
+
+    explicit StreamRng(uint64_t seed = 0) : state(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+/* 
+   TEMPLATE: Deck<T, Engine>
    Allows any card type (string, int, structs, etc.)
+   and any random engine for shuffling (the RNG quality harness swaps it)
     */
    
-template<typename T>
+template<typename T, typename Engine = mt19937>
 class Deck {
 private:
     vector<T> cards;
+    Engine& rng;    // owned by the Game, so every table shuffles independently
 
 public:
-    Deck() {
+    explicit Deck(Engine& r) : rng(r) {
         reset();
     }
 
@@ -35,10 +106,23 @@ public:
         for (int i = 0; i < 6; ++i) cards.push_back("Moon");
         for (int i = 0; i < 2; ++i) cards.push_back("Magic");
 
-        static std::mt19937 rng((unsigned)time(nullptr));
         std::shuffle(cards.begin(), cards.end(), rng);
     }
 
+    // Removes one copy of card from the deck; false if none is left
+    bool take(const T& card) {
+        auto it = find(cards.begin(), cards.end(), card);
+        if (it == cards.end()) return false;
+        cards.erase(it);
+        return true;
+    }
+
+    static constexpr int fullSize = 20;   // cards after reset()
+
+    size_t memoryBytes() const { return heapBytes(cards); }
+
+    int size() const { return (int)cards.size(); }
+
     vector<T> deal(int n) {
         vector<T> hand;
         for (int i = 0; i < n && !cards.empty(); ++i) {
@@ -75,6 +159,8 @@ public:
         return hand;
     }
 
+    size_t memoryBytes() const { return heapBytes(name) + heapBytes(hand); }
+
     void removeCardAt(int idx) {
         if (idx >= 0 && idx < (int)hand.size())
             hand.erase(hand.begin() + idx);
@@ -90,30 +176,370 @@ public:
         return played;
     }
 
-    void showHand() const {
-        cout << name << ": ";
+    void showHand(ostream& out) const {
+        out << name << ": ";
         for (const T& c : hand)
-            cout << c << " ";
-        cout << endl;
+            out << c << " ";
+        out << "\n";
+    }
+};
+
+/* 
+   FlightRecorder: fixed-size ring buffer of the last events of a table.
+   Recording is a handful of stores into a preallocated array, so it is
+   always on. The buffer is written to disk when something goes wrong
+   (or when asked to) so odd games can be inspected afterwards.
+    */
+enum class FlightEventType : uint8_t {
+    RoundStart = 1, // seat = starter, a = focus index
+    Play,           // seat = player, a = cards played, b = cards left in hand
+    Question,       // seat = questioner, a = questioned seat, b = 1 if the play was correct
+    Bomb,           // seat = victim, a = 0 survived / 1 exploded / 2 third bomb, b = survived bombs after
+    Win             // seat = winner
+};
+
+struct FlightEvent {
+    FlightEventType type;
+    uint8_t seat;
+    uint8_t a;
+    uint8_t b;
+    uint16_t round;
+    uint16_t turn;
+};
+static_assert(sizeof(FlightEvent) == 8, "flight events are written to disk as-is");
+
+class FlightRecorder {
+public:
+    static constexpr uint32_t capacity = 256;   // power of two
+
+private:
+    FlightEvent events[capacity];
+    uint32_t head = 0;   // total events recorded
+
+public:
+    void record(FlightEventType type, int seat, int a, int b, int round, int turn) {
+        FlightEvent& e = events[head++ & (capacity - 1)];
+        e.type = type;
+        e.seat = (uint8_t)seat;
+        e.a = (uint8_t)a;
+        e.b = (uint8_t)b;
+        e.round = (uint16_t)round;
+        e.turn = (uint16_t)turn;
+    }
+
+    /* 
+       File layout: "BBFR", then version, seed and event count as
+       little-endian uint32, then the events oldest first.
+        */
+    bool dump(const string& path, uint32_t seed) const {
+        ofstream file(path, ios::binary);
+        if (!file) return false;
+        uint32_t count = min(head, capacity);
+        uint32_t header[3] = {1, seed, count};
+        file.write("BBFR", 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof header);
+        for (uint32_t i = head - count; i != head; ++i)
+            file.write(reinterpret_cast<const char*>(&events[i & (capacity - 1)]), sizeof(FlightEvent));
+        return (bool)file;
+    }
+};
+
+/* 
+   Human input.
+   InputSource is where the human seat's answers come from: the console,
+   a script file, or an in-memory queue. Reading and validation report
+   an InputError code instead of throwing, since a mistyped answer is
+   ordinary input; only running out of input ends the game with an error.
+    */
+enum class InputError {
+    None,
+    NotANumber,
+    CountOutOfRange,
+    NotEnoughCards,
+    IndexOutOfRange,
+    DuplicateIndex,
+    EndOfInput
+};
+
+inline string inputErrorMessage(InputError err, int handSize) {
+    switch (err) {
+        case InputError::NotANumber:      return "Invalid input! Please enter an integer.";
+        case InputError::CountOutOfRange: return "Number of cards must be between 1 and 3.";
+        case InputError::NotEnoughCards:  return "You only have " + to_string(handSize) + " card(s).";
+        case InputError::IndexOutOfRange: return "Index out of range.";
+        case InputError::DuplicateIndex:  return "Index already chosen.";
+        case InputError::EndOfInput:      return "No more input.";
+        default:                          return "";
+    }
+}
+
+inline InputError validateCount(int n, int handSize) {
+    if (n < 1 || n > 3) return InputError::CountOutOfRange;
+    if (n > handSize) return InputError::NotEnoughCards;
+    return InputError::None;
+}
+
+// idx is zero-based
+inline InputError validateIndex(int idx, int handSize, const vector<int>& chosen) {
+    if (idx < 0 || idx >= handSize) return InputError::IndexOutOfRange;
+    if (find(chosen.begin(), chosen.end(), idx) != chosen.end()) return InputError::DuplicateIndex;
+    return InputError::None;
+}
+
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+    virtual InputError readInt(int& value) = 0;
+    virtual InputError readChar(char& value) = 0;
+};
+
+// Console or any other stream; a bad answer skips the rest of its line
+class StreamInput : public InputSource {
+private:
+    istream& in;
+
+public:
+    explicit StreamInput(istream& s) : in(s) {}
+
+    InputError readInt(int& value) override {
+        if (in >> value) return InputError::None;
+        if (in.eof()) return InputError::EndOfInput;
+        in.clear();
+        in.ignore(numeric_limits<streamsize>::max(), '\n');
+        return InputError::NotANumber;
+    }
+
+    InputError readChar(char& value) override {
+        return (in >> value) ? InputError::None : InputError::EndOfInput;
     }
 };
 
+class FileInput : public InputSource {
+private:
+    ifstream file;
+    StreamInput reader;
+
+public:
+    explicit FileInput(const string& path) : file(path), reader(file) {
+        if (!file) throw runtime_error("Cannot read " + path);
+    }
+
+    InputError readInt(int& value) override { return reader.readInt(value); }
+    InputError readChar(char& value) override { return reader.readChar(value); }
+};
+
+// Answers queued in memory, one token each
+class QueueInput : public InputSource {
+private:
+    deque<string> tokens;
+
+public:
+    QueueInput() = default;
+    explicit QueueInput(const string& script) {
+        istringstream in(script);
+        string token;
+        while (in >> token) push(token);
+    }
+
+    void push(const string& token) { tokens.push_back(token); }
+
+    InputError readInt(int& value) override {
+        if (tokens.empty()) return InputError::EndOfInput;
+        string token = tokens.front();
+        tokens.pop_front();
+        char* end = nullptr;
+        long v = strtol(token.c_str(), &end, 10);
+        if (end == token.c_str() || *end != '\0') return InputError::NotANumber;
+        value = (int)v;
+        return InputError::None;
+    }
+
+    InputError readChar(char& value) override {
+        if (tokens.empty()) return InputError::EndOfInput;
+        string& token = tokens.front();
+        value = token[0];
+        token.erase(0, 1);
+        if (token.empty()) tokens.pop_front();
+        return InputError::None;
+    }
+};
+
+// Passes answers through and appends each one to a log, so a session can be replayed
+class RecordingInput : public InputSource {
+private:
+    InputSource& source;
+    ostream& log;
+
+public:
+    RecordingInput(InputSource& src, ostream& l) : source(src), log(l) {}
+
+    InputError readInt(int& value) override {
+        InputError err = source.readInt(value);
+        if (err == InputError::None) log << value << "\n";
+        else if (err == InputError::NotANumber) log << "?\n";
+        return err;
+    }
+
+    InputError readChar(char& value) override {
+        InputError err = source.readChar(value);
+        if (err == InputError::None) log << value << "\n";
+        return err;
+    }
+};
+
+/* 
+   GameConfig: rules and seat setup for one table.
+   Defaults reproduce the interactive game (1 human + 3 bots).
+    */
+struct GameConfig {
+    unsigned seed = 0;
+    bool humanSeat = true;       // false = bot-only (headless) table
+    int numBots = 3;             // total seats must stay within 2..4 (20-card deck)
+    int bombOneIn = 3;           // bomb explodes with probability 1/bombOneIn
+    int botQuestionPercent = 30; // chance a bot questions the previous player
+    vector<int> seatQuestionPercent; // per-seat override of botQuestionPercent (empty = none)
+    bool verbose = true;         // narrate to stdout
+    int firstPlayer = -1;        // force the opening seat (-1 = random)
+    int firstFocus = -1;         // force the first round's focus, index into Game::focusCards (-1 = random)
+
+    // Importance sampling: when >= 0, bomb rolls / bot question decisions are
+    // drawn with these probabilities instead and GameResult::logWeight
+    // carries the likelihood ratio back to the real rules.
+    double bombProposal = -1.0;
+    double questionProposal = -1.0;
+
+    // Force seat 0's first hand: counts of Sun, Moon, Star, Magic (empty = deal normally)
+    vector<int> firstHandCounts;
+
+    // Where flight records are dumped on anomalies ("" = never write them).
+    // Off by default; only the command-line front ends pick a directory.
+    string flightRecordDir;
+
+    // Per-table memory budget in bytes, checked after every deal (0 = unlimited)
+    size_t memoryBudget = 0;
+
+    // Step watchdog: turn-loop iterations allowed per game (0 = unlimited)
+    long maxSteps = 0;
+
+    // Where the human seat's answers come from (not owned; null = console)
+    InputSource* input = nullptr;
+};
+
+// Bot-only table with no narration: simulations, benchmarks and the C API
+inline GameConfig headlessConfig(int seats) {
+    GameConfig cfg;
+    cfg.humanSeat = false;
+    cfg.numBots = seats;
+    cfg.verbose = false;
+    return cfg;
+}
+
+// Thrown when a rule invariant breaks (a bug, never bad input)
+struct InvariantViolation : logic_error {
+    using logic_error::logic_error;
+};
+
+// Thrown when the human's answers run out: the player quit, not an anomaly
+struct InputEnded : runtime_error {
+    using runtime_error::runtime_error;
+};
+
+// Thrown when a table exceeds GameConfig::maxSteps
+struct WatchdogTimeout : runtime_error {
+    using runtime_error::runtime_error;
+};
+
+// Bytes a live table holds, by subsystem (see Game::memoryUsage)
+struct MemoryUsage {
+    size_t table = 0;        // the Game object itself (includes RNGs and flight recorder)
+    size_t players = 0;      // names and hands
+    size_t strikes = 0;      // surviveCount map
+    size_t lastPlayed = 0;   // hidden last plays
+    size_t deck = 0;
+    size_t config = 0;       // heap parts of GameConfig
+
+    size_t total() const { return table + players + strikes + lastPlayed + deck + config; }
+};
+
+// Summary of one finished game (also what the C API hands back)
+struct GameResult {
+    int winner = -1;        // seat index, -1 if nobody survived
+    int firstPlayer = -1;
+    int firstFocus = -1;
+    int rounds = 0;
+    int questions = 0;
+    int bombs = 0;          // bombs that exploded
+    int turns = 0;
+    int winnerBombsSurvived = 0;
+    double logWeight = 0.0; // log likelihood ratio (0 unless proposals are set)
+    uint64_t digest = 0;    // FNV-1a over every flight-recorder event, for replay checks
+};
+
 /* 
    Game Class (NOT template – uses Player<string> & Deck<string>)
     */
 class Game {
 private:
+    GameConfig config;
+    // All randomness of this table (no global rand()), split into
+    // independent streams so the deals, focus cards and bomb rolls of a
+    // seed do not depend on what the players decide.
+    StreamRng deckRng;    // Deck::reset shuffles
+    StreamRng tableRng;   // first player and focus cards
+    StreamRng bombRng;
+    StreamRng botRng;     // bot play counts and question decisions
+    ostream quiet;      // null stream used when not verbose
+    ostream& out;
+
     vector<Player<string>> players;
     int currentPlayerIndex;
-    Deck<string> deck;
+    Deck<string, StreamRng> deck;
+    GameResult result;
+    FlightRecorder recorder;
+    StreamInput console{cin};
+    long steps = 0;      // turn-loop iterations, for the watchdog
+    int discarded = 0;   // cards played since the last deal
     unordered_map<string, int> surviveCount;  // Tracks number of survivals after questioning
 
     // store last played cards for each player (hidden until questioning)
     vector<vector<string>> lastPlayedByIndex;
 
-    static string randomFocusCard() {
-        static vector<string> cards = {"Sun", "Moon", "Star"};
-        return cards[rand() % cards.size()];
+    int randomFocusIndex() {
+        return uniform_int_distribution<int>(0, 2)(tableRng);
+    }
+
+    // Draws from the proposal q instead of the real probability p and
+    // accumulates the likelihood ratio of the outcome.
+    bool proposalRoll(StreamRng& rng, double p, double q) {
+        bool hit = uniform_real_distribution<double>(0.0, 1.0)(rng) < q;
+        result.logWeight += hit ? log(p / q) : log((1.0 - p) / (1.0 - q));
+        return hit;
+    }
+
+    bool bombExplodes() {
+        if (config.bombProposal >= 0)
+            return proposalRoll(bombRng, 1.0 / config.bombOneIn, config.bombProposal);
+        return uniform_int_distribution<int>(1, config.bombOneIn)(bombRng) == 1;
+    }
+
+    static int questionPercent(const GameConfig& cfg, int seat) {
+        return cfg.seatQuestionPercent.empty() ? cfg.botQuestionPercent
+                                               : cfg.seatQuestionPercent[seat];
+    }
+
+    int questionPercent(int seat) const {
+        return questionPercent(config, seat);
+    }
+
+    bool botDecidesToQuestion(int seat) {
+        int pct = questionPercent(seat);
+        if (config.questionProposal >= 0)
+            return proposalRoll(botRng, pct / 100.0, config.questionProposal);
+        return uniform_int_distribution<int>(0, 99)(botRng) < pct;
+    }
+
+    int botPlayCount() {
+        return uniform_int_distribution<int>(1, 3)(botRng);
     }
 
     // Treat empty played vector as incorrect/unknown (so forced questioning is meaningful)
@@ -150,6 +576,7 @@ private:
     }
 
     void dealCardsToAlive(int cardsPerPlayer) {
+        discarded = 0;
         for (auto& p : players) {
             if (p.isAlive()) {
                 p.setHand(deck.deal(cardsPerPlayer));
@@ -157,13 +584,68 @@ private:
         }
     }
 
+    void record(FlightEventType type, int seat, int a = 0, int b = 0) {
+        recorder.record(type, seat, a, b, result.rounds, result.turns);
+        const uint8_t bytes[] = {(uint8_t)type, (uint8_t)seat, (uint8_t)a, (uint8_t)b,
+                                 (uint8_t)result.rounds, (uint8_t)result.turns};
+        for (uint8_t byte : bytes)
+            result.digest = (result.digest ^ byte) * 0x100000001B3ULL;
+    }
+
+    // Cheap per-turn sanity checks; a failure dumps the flight record
+    void checkInvariants() {
+        if (config.maxSteps && ++steps > config.maxSteps)
+            throw WatchdogTimeout("Game still running after " + to_string(config.maxSteps) + " steps.");
+
+        // every card of the current deal is in a live hand, in the deck, or played
+        int cards = deck.size() + discarded;
+        for (const auto& p : players)
+            if (p.isAlive()) cards += (int)p.getHand().size();
+        if (cards != Deck<string, StreamRng>::fullSize)
+            throw InvariantViolation("Cards are not conserved: " + to_string(cards) + " accounted for.");
+
+        for (const auto& p : players) {
+            if (p.getHand().size() > 5)
+                throw InvariantViolation(p.getName() + " holds more than 5 cards.");
+            auto it = surviveCount.find(p.getName());
+            if (it != surviveCount.end() && (it->second < 0 || it->second > 2))
+                throw InvariantViolation(p.getName() + " has an impossible bomb count.");
+        }
+    }
+
+    void checkMemoryBudget() const {
+        if (config.memoryBudget && memoryUsage().total() > config.memoryBudget)
+            throw runtime_error("Table exceeds its memory budget of "
+                                + to_string(config.memoryBudget) + " bytes.");
+    }
+
+    InputSource& humanInput() {
+        return config.input ? *config.input : console;
+    }
+
+    // Seat 0 gets config.firstHandCounts (in shuffled order), the rest deal normally
+    void dealForcedFirstHand() {
+        static constexpr const char* names[] = {"Sun", "Moon", "Star", "Magic"};
+        vector<string> hand;
+        for (int c = 0; c < 4; ++c)
+            for (int i = 0; i < config.firstHandCounts[c]; ++i) {
+                deck.take(names[c]);
+                hand.push_back(names[c]);
+            }
+        std::shuffle(hand.begin(), hand.end(), deckRng);
+        discarded = 0;
+        players[0].setHand(hand);
+        for (int i = 1; i < (int)players.size(); ++i)
+            players[i].setHand(deck.deal(5));
+    }
+
     // Show human's hand only (we keep human visibility A)
     void showHumanHand() {
         for (const auto& p : players) {
             if (p.getName() == "Human" && p.isAlive()) {
-                cout << "--- Your Hand ---\n";
-                p.showHand();
-                cout << endl;
+                out << "--- Your Hand ---\n";
+                p.showHand(out);
+                out << endl;
                 return;
             }
         }
@@ -181,35 +663,45 @@ private:
                            const vector<string>& played,
                            const string& focus)
     {
+        result.questions++;
+
         // Reveal the played cards (since a question occurred)
-        cout << "\nRevealing cards of " << playerWhoPlayed.getName() << ": ";
+        out << "\nRevealing cards of " << playerWhoPlayed.getName() << ": ";
         if (played.empty()) {
-            cout << "(no record of played cards)\n";
+            out << "(no record of played cards)\n";
         } else {
             for (auto& c : played)
-                cout << c << " ";
-            cout << "\n";
+                out << c << " ";
+            out << "\n";
         }
 
         bool correctPlay = playIsCorrect(played, focus);
+        record(FlightEventType::Question, findPlayerIndex(questioner.getName()),
+               findPlayerIndex(playerWhoPlayed.getName()), correctPlay);
 
         if (!correctPlay) {
-            cout << playerWhoPlayed.getName() << " played wrongly!\n";
-            cout << questioner.getName() << " was right to question!\n";
+            out << playerWhoPlayed.getName() << " played wrongly!\n";
+            out << questioner.getName() << " was right to question!\n";
 
             if (surviveCount[playerWhoPlayed.getName()] >= 2) {
-                cout << "Bomb exploded! " << playerWhoPlayed.getName() << " has died (3rd time bomb)!\n";
+                out << "Bomb exploded! " << playerWhoPlayed.getName() << " has died (3rd time bomb)!\n";
                 playerWhoPlayed.setAlive(false);
+                result.bombs++;
                 surviveCount[playerWhoPlayed.getName()] = 0;
+                record(FlightEventType::Bomb, findPlayerIndex(playerWhoPlayed.getName()), 2, 0);
             }
-            else if (rand() % 3 == 0) {
-                cout << "Bomb exploded! " << playerWhoPlayed.getName() << " has died.\n";
+            else if (bombExplodes()) {
+                out << "Bomb exploded! " << playerWhoPlayed.getName() << " has died.\n";
                 playerWhoPlayed.setAlive(false);
+                result.bombs++;
                 surviveCount[playerWhoPlayed.getName()] = 0;
+                record(FlightEventType::Bomb, findPlayerIndex(playerWhoPlayed.getName()), 1, 0);
             } else {
-                cout << "Bomb did not explode this time! "
-                     << playerWhoPlayed.getName() << " has survived.\n";
+                out << "Bomb did not explode this time! "
+                    << playerWhoPlayed.getName() << " has survived.\n";
                 surviveCount[playerWhoPlayed.getName()]++;
+                record(FlightEventType::Bomb, findPlayerIndex(playerWhoPlayed.getName()), 0,
+                       surviveCount[playerWhoPlayed.getName()]);
             }
 
             int idx = findPlayerIndex(questioner.getName());
@@ -221,21 +713,27 @@ private:
             return true;
         }
         else {
-            cout << questioner.getName() << " was wrong to question!\n";
+            out << questioner.getName() << " was wrong to question!\n";
 
             if (surviveCount[questioner.getName()] >= 2) {
-                cout << "Bomb exploded! " << questioner.getName() << " has died (3rd time bomb)!\n";
+                out << "Bomb exploded! " << questioner.getName() << " has died (3rd time bomb)!\n";
                 questioner.setAlive(false);
+                result.bombs++;
                 surviveCount[questioner.getName()] = 0;
+                record(FlightEventType::Bomb, findPlayerIndex(questioner.getName()), 2, 0);
             }
-            else if (rand() % 3 == 0) {
-                cout << "Bomb exploded! " << questioner.getName() << " has died.\n";
+            else if (bombExplodes()) {
+                out << "Bomb exploded! " << questioner.getName() << " has died.\n";
                 questioner.setAlive(false);
+                result.bombs++;
                 surviveCount[questioner.getName()] = 0;
+                record(FlightEventType::Bomb, findPlayerIndex(questioner.getName()), 1, 0);
             } else {
-                cout << "Bomb did not explode this time! "
-                     << questioner.getName() << " has survived\n";
+                out << "Bomb did not explode this time! "
+                    << questioner.getName() << " has survived\n";
                 surviveCount[questioner.getName()]++;
+                record(FlightEventType::Bomb, findPlayerIndex(questioner.getName()), 0,
+                       surviveCount[questioner.getName()]);
             }
 
             int idx = findPlayerIndex(questioner.getName());
@@ -248,14 +746,86 @@ private:
         }
     }
 
+    // Starting state of one of the table's RNG streams: splitmix64 of (seed, stream),
+    // so the four streams start far apart in the 2^64 sequence
+    static uint64_t streamSeed(unsigned seed, unsigned stream) {
+        return StreamRng((uint64_t)seed << 8 | stream)();
+    }
+
 public:
-    Game() {
-        players.emplace_back("Human");
-        players.emplace_back("Bot1");
-        players.emplace_back("Bot2");
-        players.emplace_back("Bot3");
+    static constexpr const char* focusCards[] = {"Sun", "Moon", "Star"};
+    static constexpr int numFocusCards = 3;
+
+    // Throws invalid_argument for a config no table could be built from
+    static void validate(const GameConfig& cfg) {
+        int seats = cfg.numBots + (cfg.humanSeat ? 1 : 0);
+        if (seats < 2 || seats > 4)
+            throw invalid_argument("A table needs 2 to 4 players.");
+        if (cfg.bombOneIn < 1)
+            throw invalid_argument("bombOneIn must be at least 1.");
+        if (cfg.botQuestionPercent < 0 || cfg.botQuestionPercent > 100)
+            throw invalid_argument("botQuestionPercent must be between 0 and 100.");
+        if (!cfg.seatQuestionPercent.empty()) {
+            if ((int)cfg.seatQuestionPercent.size() != seats)
+                throw invalid_argument("seatQuestionPercent needs one entry per seat.");
+            for (int pct : cfg.seatQuestionPercent)
+                if (pct < 0 || pct > 100)
+                    throw invalid_argument("seatQuestionPercent entries must be between 0 and 100.");
+        }
+        // Only questions end a round with 3+ players alive, so a table that can be
+        // left with three bots that never question would never finish
+        int silentBots = 0;
+        for (int seat = cfg.humanSeat ? 1 : 0; seat < seats; ++seat)
+            if (questionPercent(cfg, seat) == 0)
+                silentBots++;
+        if (silentBots >= 3)
+            throw invalid_argument("At most two bots may have a question rate of 0.");
+        if (cfg.firstPlayer >= seats)
+            throw invalid_argument("firstPlayer is not a seat at this table.");
+        if (cfg.firstFocus >= numFocusCards)
+            throw invalid_argument("firstFocus is not a focus card.");
+        if (!cfg.firstHandCounts.empty()) {
+            static constexpr int available[] = {6, 6, 6, 2};
+            int total = 0;
+            for (int i = 0; i < (int)cfg.firstHandCounts.size() && i < 4; ++i) {
+                if (cfg.firstHandCounts[i] < 0 || cfg.firstHandCounts[i] > available[i])
+                    throw invalid_argument("firstHandCounts asks for cards the deck does not have.");
+                total += cfg.firstHandCounts[i];
+            }
+            if (cfg.firstHandCounts.size() != 4 || total != 5)
+                throw invalid_argument("firstHandCounts needs 4 counts adding up to 5.");
+        }
+        // a proposal must be able to produce every outcome the real rules can
+        if (cfg.bombProposal >= 0 && (cfg.bombProposal <= 0.0 || cfg.bombProposal >= 1.0
+                                      || cfg.bombOneIn == 1))
+            throw invalid_argument("bombProposal must be in (0, 1) and bombOneIn above 1.");
+        if (cfg.questionProposal >= 0) {
+            if (cfg.questionProposal <= 0.0 || cfg.questionProposal >= 1.0)
+                throw invalid_argument("questionProposal must be in (0, 1).");
+            // every bot's own rate, since a 0% or 100% seat would get a zero weight
+            for (int seat = cfg.humanSeat ? 1 : 0; seat < seats; ++seat)
+                if (questionPercent(cfg, seat) % 100 == 0)
+                    throw invalid_argument("questionProposal needs every bot's question rate strictly between 0 and 100.");
+        }
+    }
+
+    explicit Game(const GameConfig& cfg)
+        : config(cfg),
+          deckRng(streamSeed(cfg.seed, 1)), tableRng(streamSeed(cfg.seed, 2)),
+          bombRng(streamSeed(cfg.seed, 3)), botRng(streamSeed(cfg.seed, 4)),
+          quiet(nullptr), out(cfg.verbose ? cout : quiet), deck(deckRng)
+    {
+        validate(cfg);
+        int seats = cfg.numBots + (cfg.humanSeat ? 1 : 0);
+
+        if (cfg.humanSeat)
+            players.emplace_back("Human");
+        for (int i = 1; i <= cfg.numBots; ++i)
+            players.emplace_back("Bot" + to_string(i));
 
-        currentPlayerIndex = rand() % players.size();
+        currentPlayerIndex = uniform_int_distribution<int>(0, seats - 1)(tableRng);
+        if (cfg.firstPlayer >= 0)
+            currentPlayerIndex = cfg.firstPlayer;
 
         // Initialize surviveCount map for all players
         for (auto& p : players)
@@ -265,239 +835,2079 @@ public:
         lastPlayedByIndex.resize(players.size());
     }
 
-    void play() {
+    // Plays the game to the end and returns its summary
+    GameResult play() {
+        try {
+            return runGame();
+        } catch (const InputEnded&) {
+            throw;
+        } catch (const InvariantViolation&) {
+            dumpFlightRecord("invariant");
+            throw;
+        } catch (const WatchdogTimeout&) {
+            dumpFlightRecord("watchdog");
+            throw;
+        } catch (const exception&) {
+            dumpFlightRecord("exception");
+            throw;
+        }
+    }
+
+    // Writes the table's recent events to flightRecordDir; returns the file, or "" if none
+    string dumpFlightRecord(const string& reason) const {
+        if (config.flightRecordDir.empty()) return "";
+        string path = config.flightRecordDir + "/bluffbar-flight-" + to_string(config.seed)
+                      + "-" + reason + ".bin";
+        return recorder.dump(path, config.seed) ? path : "";
+    }
+
+private:
+    GameResult runGame() {
+        result = GameResult();
+        result.digest = 0xCBF29CE484222325ULL;   // FNV offset basis
+        steps = 0;
+        result.firstPlayer = currentPlayerIndex;
+
         deck.reset();
-        dealCardsToAlive(5);
+        if (config.firstHandCounts.empty()) {
+            dealCardsToAlive(5);
+        } else {
+            dealForcedFirstHand();
+        }
+        checkMemoryBudget();
 
         // show only human hand (A option)
         showHumanHand();
 
-        cout << "First player: " << players[currentPlayerIndex].getName() << "\n\n";
+        out << "First player: " << players[currentPlayerIndex].getName() << "\n\n";
 
         // main loop: use countAliveWithCards to ensure someone can act
-        while (countAliveWithCards() > 1) {
-            string focus = randomFocusCard();
-            cout << "--- Round begins! Focus card: " << focus << " ---\n";
+        while (countAliveWithCards() > 1)
+            playRound();
+
+        for (int i = 0; i < (int)players.size(); ++i)
+            if (players[i].isAlive()) {
+                out << players[i].getName() << " wins!\n";
+                result.winner = i;
+                result.winnerBombsSurvived = surviveCount[players[i].getName()];
+                record(FlightEventType::Win, i);
+                break;
+            }
+        return result;
+    }
 
-            bool roundOver = false;
-            bool anyQuestionAsked = false;
+public:
+    // Plays one round from the current deal, then re-deals for the next one
+    void playRound() {
+        // always draw, so a forced first focus leaves tableRng's later draws unchanged
+        int focusIdx = randomFocusIndex();
+        if (result.rounds == 0 && config.firstFocus >= 0) focusIdx = config.firstFocus;
+        if (result.rounds == 0) result.firstFocus = focusIdx;
+        string focus = focusCards[focusIdx];
+        result.rounds++;
+        record(FlightEventType::RoundStart, currentPlayerIndex, focusIdx);
+        out << "--- Round begins! Focus card: " << focus << " ---\n";
+
+        bool roundOver = false;
+        bool anyQuestionAsked = false;
+
+        while (!roundOver) {
+            if (countAliveWithCards() <= 1) {
+                // No one left who can play; end round safely
+                break;
+            }
 
-            while (!roundOver) {
-                if (countAliveWithCards() <= 1) {
-                    // No one left who can play; end round safely
-                    break;
-                }
+            checkInvariants();
+            Player<string>& currentPlayer = players[currentPlayerIndex];
 
-                Player<string>& currentPlayer = players[currentPlayerIndex];
+            // Skip player if dead or no cards left
+            if (!currentPlayer.isAlive() || currentPlayer.getHand().empty()) {
+                int nxt = getNextAlivePlayer(currentPlayerIndex);
+                if (nxt == -1) { roundOver = true; break; }
+                currentPlayerIndex = nxt;
+                continue;
+            }
 
-                // Skip player if dead or no cards left
-                if (!currentPlayer.isAlive() || currentPlayer.getHand().empty()) {
-                    int nxt = getNextAlivePlayer(currentPlayerIndex);
-                    if (nxt == -1) { roundOver = true; break; }
-                    currentPlayerIndex = nxt;
-                    continue;
+            /* 
+               HUMAN TURN (answers from config.input, validated by error code)
+                */
+            if (currentPlayer.getName() == "Human") {
+                out << "Your hand:\n";
+                const auto& hand = currentPlayer.getHand();
+                for (int i = 0; i < (int)hand.size(); ++i)
+                    out << i+1 << ": " << hand[i] << "  ";
+
+                int n;
+                while (true) {
+                    out << "\nHow many cards you want to play (1-3)? ";
+                    InputError err = humanInput().readInt(n);
+                    if (err == InputError::None) err = validateCount(n, (int)hand.size());
+                    if (err == InputError::None) break;
+                    if (err == InputError::EndOfInput)
+                        throw InputEnded("Human input ended mid-game.");
+                    out << inputErrorMessage(err, (int)hand.size()) << "\nTry again.\n";
                 }
 
-                /* 
-                   HUMAN TURN with exception handling
-                    */
-                if (currentPlayer.getName() == "Human") {
-                    cout << "Your hand:\n";
-                    const auto& hand = currentPlayer.getHand();
-                    for (int i = 0; i < (int)hand.size(); ++i)
-                        cout << i+1 << ": " << hand[i] << "  ";
-
-                    int n;
-                    while (true) {
-                        try {
-                            cout << "\nHow many cards you want to play (1-3)? ";
-                            cin >> n;
-
-                            if (cin.fail()) {
-                                cin.clear();
-                                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                                throw runtime_error("Invalid input! Please enter an integer.");
-                            }
-
-                            if (n < 1 || n > 3) {
-                                throw out_of_range("Number of cards must be between 1 and 3.");
-                            }
-                            break;
-                        } catch (const exception& e) {
-                            cout << e.what() << "\nTry again.\n";
-                        }
+                vector<int> chosen;
+
+                while ((int)chosen.size() < n) {
+                    out << "Enter index #" << chosen.size() + 1 << ": ";
+                    int idx;
+                    InputError err = humanInput().readInt(idx);
+                    if (err == InputError::None) {
+                        idx--; // zero-based indexing
+                        err = validateIndex(idx, (int)hand.size(), chosen);
                     }
+                    if (err == InputError::None) {
+                        chosen.push_back(idx);
+                        continue;
+                    }
+                    if (err == InputError::EndOfInput)
+                        throw InputEnded("Human input ended mid-game.");
+                    out << inputErrorMessage(err, (int)hand.size()) << "\nTry again.\n";
+                }
 
-                    vector<int> chosen;
+                sort(chosen.rbegin(), chosen.rend());
 
-                    while ((int)chosen.size() < n) {
-                        try {
-                            cout << "Enter index #" << chosen.size() + 1 << ": ";
-                            int idx;
-                            cin >> idx;
+                vector<string> played;
+                for (int idx : chosen) {
+                    played.push_back(hand[idx]);
+                    currentPlayer.removeCardAt(idx);
+                }
+                reverse(played.begin(), played.end());
 
-                            if (cin.fail()) {
-                                cin.clear();
-                                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                                throw runtime_error("Invalid input! Please enter an integer.");
-                            }
+                // Store played secretly (indexed by player index)
+                {
+                    int curIdx = findPlayerIndex(currentPlayer.getName());
+                    if (curIdx != -1) lastPlayedByIndex[curIdx] = played;
+                }
 
-                            idx--; // zero-based indexing
+                result.turns++;
+                discarded += (int)played.size();
+                record(FlightEventType::Play, currentPlayerIndex, (int)played.size(),
+                       (int)currentPlayer.getHand().size());
+
+                // DO NOT reveal which cards — only show count
+                out << "Human played " << played.size() << " card(s).\n";
+
+                int next = getNextAlivePlayer(currentPlayerIndex);
+                if (next == -1) { roundOver = true; break; }
+                auto& nextP = players[next];
+
+                if (nextP.getName().find("Bot") != string::npos) {
+                    if (botDecidesToQuestion(next)) {
+                        out << nextP.getName() << " decides to question!\n";
+                        // Reveal player's last played cards to the questioning logic
+                        int playedOwnerIdx = findPlayerIndex(currentPlayer.getName());
+                        vector<string> toCheck;
+                        if (playedOwnerIdx != -1) toCheck = lastPlayedByIndex[playedOwnerIdx];
+
+                        roundOver = handleQuestioning(nextP, currentPlayer, toCheck, focus);
+                        anyQuestionAsked = true;
+                    } else {
+                        out << nextP.getName() << " decides NOT to question.\n";
+                    }
+                }
+            }
 
-                            if (idx < 0 || idx >= (int)hand.size())
-                                throw out_of_range("Index out of range.");
+            /* 
+               BOT TURN
+                */
+            else {
+                int n = botPlayCount();
+                vector<string> played = currentPlayer.playCards(n);
 
-                            if (find(chosen.begin(), chosen.end(), idx) != chosen.end())
-                                throw logic_error("Index already chosen.");
+                // Store secretly for later reveal if questioned
+                {
+                    int curIdx = findPlayerIndex(currentPlayer.getName());
+                    if (curIdx != -1) lastPlayedByIndex[curIdx] = played;
+                }
 
-                            chosen.push_back(idx);
-                        } catch (const exception& e) {
-                            cout << e.what() << "\nTry again.\n";
-                        }
+                result.turns++;
+                discarded += (int)played.size();
+                record(FlightEventType::Play, currentPlayerIndex, (int)played.size(),
+                       (int)currentPlayer.getHand().size());
+
+                // DO NOT print the cards themselves — only number
+                out << currentPlayer.getName() << " has played " << played.size() << " card(s) (hidden).\n";
+
+                int next = getNextAlivePlayer(currentPlayerIndex);
+                if (next == -1) { roundOver = true; break; }
+                auto& nextP = players[next];
+
+                if (nextP.getName() == "Human") {
+                    out << "Question previous player (y/n)? ";
+                    char ch;
+                    if (humanInput().readChar(ch) != InputError::None)
+                        throw InputEnded("Human input ended mid-game.");
+
+                    if (ch == 'y' || ch == 'Y') {
+                        int ownerIdx = findPlayerIndex(currentPlayer.getName());
+                        vector<string> toCheck;
+                        if (ownerIdx != -1) toCheck = lastPlayedByIndex[ownerIdx];
+
+                        roundOver = handleQuestioning(nextP, currentPlayer, toCheck, focus);
+                        anyQuestionAsked = true;
+                    } else {
+                        out << "Human decided NOT to question.\n";
                     }
-
-                    sort(chosen.rbegin(), chosen.rend());
-
-                    vector<string> played;
-                    for (int idx : chosen) {
-                        played.push_back(hand[idx]);
-                        currentPlayer.removeCardAt(idx);
+                }
+                else {
+                    if (botDecidesToQuestion(next)) {
+                        out << nextP.getName() << " decides to question!\n";
+                        int ownerIdx = findPlayerIndex(currentPlayer.getName());
+                        vector<string> toCheck;
+                        if (ownerIdx != -1) toCheck = lastPlayedByIndex[ownerIdx];
+
+                        roundOver = handleQuestioning(nextP, currentPlayer, toCheck, focus);
+                        anyQuestionAsked = true;
                     }
-                    reverse(played.begin(), played.end());
-
-                    // Store played secretly (indexed by player index)
-                    {
-                        int curIdx = findPlayerIndex(currentPlayer.getName());
-                        if (curIdx != -1) lastPlayedByIndex[curIdx] = played;
+                    else {
+                        out << nextP.getName() << " decides NOT to question.\n";
                     }
+                }
+            }
 
-                    // DO NOT reveal which cards — only show count
-                    cout << "Human played " << played.size() << " card(s).\n";
+            // *** UPDATED LOGIC: forced questioning when 2 players left alive AND previous player has no cards ***
+            if (!roundOver) {
+                int alivePlayers = countAlivePlayers();
 
-                    int next = getNextAlivePlayer(currentPlayerIndex);
+                if (!anyQuestionAsked && alivePlayers == 2) {
+                    int current = currentPlayerIndex;
+                    int next = getNextAlivePlayer(current);
                     if (next == -1) { roundOver = true; break; }
-                    auto& nextP = players[next];
-
-                    if (nextP.getName().find("Bot") != string::npos) {
-                        if ((rand() % 100) < 30) {  // 30% chance to question
-                            cout << nextP.getName() << " decides to question!\n";
-                            // Reveal player's last played cards to the questioning logic
-                            int playedOwnerIdx = findPlayerIndex(currentPlayer.getName());
-                            vector<string> toCheck;
-                            if (playedOwnerIdx != -1) toCheck = lastPlayedByIndex[playedOwnerIdx];
-
-                            roundOver = handleQuestioning(nextP, currentPlayer, toCheck, focus);
-                            anyQuestionAsked = true;
-                        } else {
-                            cout << nextP.getName() << " decides NOT to question.\n";
-                        }
-                    }
-                }
 
-                /* 
-                   BOT TURN
-                    */
-                else {
-                    int n = rand() % 3 + 1;
-                    vector<string> played = currentPlayer.playCards(n);
+                    auto& questioner = players[next];
+                    auto& previous = players[current];
 
-                    // Store secretly for later reveal if questioned
-                    {
-                        int curIdx = findPlayerIndex(currentPlayer.getName());
-                        if (curIdx != -1) lastPlayedByIndex[curIdx] = played;
-                    }
+                    // Only force question if previous player has NO cards left
+                    if (previous.getHand().empty()) {
+                        out << questioner.getName() << " is forced to question!\n";
 
-                    // DO NOT print the cards themselves — only number
-                    cout << currentPlayer.getName() << " has played " << played.size() << " card(s) (hidden).\n";
+                        int prevIdx = findPlayerIndex(previous.getName());
+                        vector<string> played;
+                        if (prevIdx != -1) played = lastPlayedByIndex[prevIdx];
 
-                    int next = getNextAlivePlayer(currentPlayerIndex);
-                    if (next == -1) { roundOver = true; break; }
-                    auto& nextP = players[next];
-
-                    if (nextP.getName() == "Human") {
-                        cout << "Question previous player (y/n)? ";
-                        char ch; cin >> ch;
-
-                        if (ch == 'y' || ch == 'Y') {
-                            int ownerIdx = findPlayerIndex(currentPlayer.getName());
-                            vector<string> toCheck;
-                            if (ownerIdx != -1) toCheck = lastPlayedByIndex[ownerIdx];
-
-                            roundOver = handleQuestioning(nextP, currentPlayer, toCheck, focus);
-                            anyQuestionAsked = true;
-                        } else {
-                            cout << "Human decided NOT to question.\n";
-                        }
-                    }
-                    else {
-                        if ((rand() % 100) < 30) {  // 30% chance to question
-                            cout << nextP.getName() << " decides to question!\n";
-                            int ownerIdx = findPlayerIndex(currentPlayer.getName());
-                            vector<string> toCheck;
-                            if (ownerIdx != -1) toCheck = lastPlayedByIndex[ownerIdx];
-
-                            roundOver = handleQuestioning(nextP, currentPlayer, toCheck, focus);
-                            anyQuestionAsked = true;
-                        }
-                        else {
-                            cout << nextP.getName() << " decides NOT to question.\n";
-                        }
+                        roundOver = handleQuestioning(questioner, previous, played, focus);
+                        anyQuestionAsked = true;
                     }
                 }
+            }
 
-                // *** UPDATED LOGIC: forced questioning when 2 players left alive AND previous player has no cards ***
-                if (!roundOver) {
-                    int alivePlayers = countAlivePlayers();
+            if (!roundOver) {
+                int nxt = getNextAlivePlayer(currentPlayerIndex);
+                if (nxt == -1) { roundOver = true; break; }
+                currentPlayerIndex = nxt;
+            }
+        } // end inner round loop
 
-                    if (!anyQuestionAsked && alivePlayers == 2) {
-                        int current = currentPlayerIndex;
-                        int next = getNextAlivePlayer(current);
-                        if (next == -1) { roundOver = true; break; }
+        out << "\nROUND OVER re-dealing cards.\n\n";
+        deck.reset();
+        dealCardsToAlive(5);
+        checkMemoryBudget();
 
-                        auto& questioner = players[next];
-                        auto& previous = players[current];
+        // show only human hand (do not reveal others)
+        showHumanHand();
+    }
 
-                        // Only force question if previous player has NO cards left
-                        if (previous.getHand().empty()) {
-                            cout << questioner.getName() << " is forced to question!\n";
+    /* 
+       Round-level state, used by the macro-step simulator:
+       alive seats (bit mask), each seat's survived bombs, and the seat
+       that opens the next round.
+        */
+    void setRoundState(unsigned aliveMask, const vector<int>& strikes, int starter) {
+        for (int i = 0; i < (int)players.size(); ++i) {
+            players[i].setAlive(aliveMask >> i & 1);
+            surviveCount[players[i].getName()] = strikes[i];
+        }
+        currentPlayerIndex = starter;
+        deck.reset();
+        dealCardsToAlive(5);
+    }
 
-                            int prevIdx = findPlayerIndex(previous.getName());
-                            vector<string> played;
-                            if (prevIdx != -1) played = lastPlayedByIndex[prevIdx];
+    unsigned aliveMask() const {
+        unsigned mask = 0;
+        for (int i = 0; i < (int)players.size(); ++i)
+            if (players[i].isAlive()) mask |= 1u << i;
+        return mask;
+    }
 
-                            roundOver = handleQuestioning(questioner, previous, played, focus);
-                            anyQuestionAsked = true;
-                        }
-                    }
-                }
+    int strikes(int seat) const {
+        return surviveCount.at(players[seat].getName());
+    }
 
-                if (!roundOver) {
-                    int nxt = getNextAlivePlayer(currentPlayerIndex);
-                    if (nxt == -1) { roundOver = true; break; }
-                    currentPlayerIndex = nxt;
-                }
-            } // end inner round loop
+    /* 
+       Bytes this table holds right now, from the containers' capacities.
+       Map nodes are counted as key/value plus a next pointer and the
+       cached hash, which is how the standard library lays them out.
+        */
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        m.table = sizeof(Game);
+        m.players = players.capacity() * sizeof(Player<string>);
+        for (const auto& p : players) m.players += p.memoryBytes();
+        m.strikes = surviveCount.bucket_count() * sizeof(void*);
+        for (const auto& kv : surviveCount)
+            m.strikes += sizeof(kv) + sizeof(void*) + sizeof(size_t) + heapBytes(kv.first);
+        m.lastPlayed = heapBytes(lastPlayedByIndex);
+        m.deck = deck.memoryBytes();
+        m.config = heapBytes(config.seatQuestionPercent) + heapBytes(config.firstHandCounts)
+                   + heapBytes(config.flightRecordDir);
+        return m;
+    }
 
-            cout << "\nROUND OVER re-dealing cards.\n\n";
-            deck.reset();
-            dealCardsToAlive(5);
+    // The seat that will actually act first next round (skips the dead)
+    int nextStarter() {
+        if (players[currentPlayerIndex].isAlive()) return currentPlayerIndex;
+        int nxt = getNextAlivePlayer(currentPlayerIndex);
+        return nxt == -1 ? currentPlayerIndex : nxt;
+    }
+};
 
-            // show only human hand (do not reveal others)
-            showHumanHand();
-            anyQuestionAsked = false;  // Reset for next round
-        } // end outer loop
+/* 
+   C API (see bluffbar.h)
+   A runner owns its config and seed stream, so any number of them
+   can live in one process. Exceptions never cross the C boundary.
+    */
+struct bb_runner {
+    GameConfig config;
+    mt19937 seeds;
+};
 
-        for (auto& p : players)
-            if (p.isAlive()) {
-                cout << p.getName() << " wins!\n";
-                break;
-            }
+// Settings are checked the way the engine checks them, so a setter
+// never accepts a table that bb_runner_run would then refuse
+static int applyRunnerConfig(bb_runner* r, const GameConfig& cfg) {
+    try {
+        Game::validate(cfg);
+    } catch (const invalid_argument&) {
+        return BB_EINVAL;
+    }
+    r->config = cfg;
+    return BB_OK;
+}
+
+extern "C" {
+
+bb_runner* bb_runner_create(unsigned seed) {
+    try {
+        bb_runner* r = new bb_runner();
+        r->config = headlessConfig(4);
+        r->config.maxSteps = 1000000;   // a game that long is an engine bug
+        r->seeds.seed(seed);
+        return r;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+int bb_runner_set_players(bb_runner* r, int numBots) {
+    if (!r || numBots < 2 || numBots > 4) return BB_EINVAL;
+    GameConfig cfg = r->config;
+    cfg.numBots = numBots;
+    return applyRunnerConfig(r, cfg);
+}
+
+int bb_runner_set_bomb_one_in(bb_runner* r, int n) {
+    if (!r || n < 1) return BB_EINVAL;
+    GameConfig cfg = r->config;
+    cfg.bombOneIn = n;
+    return applyRunnerConfig(r, cfg);
+}
+
+int bb_runner_set_question_percent(bb_runner* r, int percent) {
+    if (!r || percent < 0 || percent > 100) return BB_EINVAL;
+    GameConfig cfg = r->config;
+    cfg.botQuestionPercent = percent;
+    return applyRunnerConfig(r, cfg);
+}
+
+int bb_runner_set_memory_budget(bb_runner* r, size_t bytes) {
+    if (!r) return BB_EINVAL;
+    r->config.memoryBudget = bytes;
+    return BB_OK;
+}
+
+int bb_runner_run(bb_runner* r, int n, bb_game_result* results) {
+    if (!r || n < 0 || (n > 0 && !results)) return BB_EINVAL;
+    try {
+        for (int i = 0; i < n; ++i) {
+            GameConfig cfg = r->config;
+            cfg.seed = r->seeds();
+            Game game(cfg);
+            GameResult res = game.play();
+            results[i].winner = res.winner;
+            results[i].first_player = res.firstPlayer;
+            results[i].rounds = res.rounds;
+            results[i].questions = res.questions;
+            results[i].bombs = res.bombs;
+        }
+    } catch (...) {
+        return BB_EFAIL;
     }
+    return BB_OK;
+}
+
+void bb_runner_free(bb_runner* r) {
+    delete r;
+}
+
+} // extern "C"
+
+#ifndef BLUFFBAR_LIBRARY   // command-line tools and main; not part of the library
+/* 
+   SIMULATION TOOLS (headless, bot-only tables)
+    */
+
+// Parses a positive count from the command line; 0 on bad input
+static long parseCount(const char* arg) {
+    char* end = nullptr;
+    long v = strtol(arg, &end, 10);
+    return (end && *end == '\0' && v > 0) ? v : 0;
+}
+
+/* 
+   CPU topology: CPUs listed node by node (from sysfs), so worker i and
+   worker i+1 share a NUMA node until that node is full. Only CPUs this
+   process may run on (taskset, cgroup cpusets) are listed. Falls back to
+   the allowed CPUs on a single node when sysfs has no node information.
+    */
+struct CpuTopology {
+    vector<int> cpus;    // placement order
+    vector<int> nodeOf;  // nodeOf[k] = node of cpus[k]
+    int nodes = 1;
 };
 
-int main() {
-    srand(time(0));
-    Game game;
-    game.play();
+static vector<int> parseCpuList(const string& list) {
+    vector<int> cpus;
+    istringstream in(list);
+    string range;
+    while (getline(in, range, ',')) {
+        int lo = 0, hi = -1;
+        if (sscanf(range.c_str(), "%d-%d", &lo, &hi) == 1) hi = lo;
+        for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+static string readLine(const string& path) {
+    ifstream file(path);
+    string line;
+    getline(file, line);
+    return line;
+}
+
+static const CpuTopology& cpuTopology() {
+    static const CpuTopology topo = []() {
+        vector<int> allowed;
+#ifdef __linux__
+        cpu_set_t mask;
+        if (sched_getaffinity(0, sizeof mask, &mask) == 0)
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &mask)) allowed.push_back(c);
+#endif
+        if (allowed.empty())
+            for (unsigned c = 0; c < max(1u, thread::hardware_concurrency()); ++c)
+                allowed.push_back((int)c);
+
+        CpuTopology t;
+        t.nodes = 0;
+        // node IDs may be sparse, so walk the online list rather than node0, node1, ...
+        for (int node : parseCpuList(readLine("/sys/devices/system/node/online"))) {
+            bool any = false;
+            for (int c : parseCpuList(readLine("/sys/devices/system/node/node" + to_string(node) + "/cpulist"))) {
+                if (!binary_search(allowed.begin(), allowed.end(), c)) continue;
+                t.cpus.push_back(c);
+                t.nodeOf.push_back(t.nodes);
+                any = true;
+            }
+            if (any) t.nodes++;
+        }
+        if (t.cpus.empty()) {
+            t.nodes = 1;
+            t.cpus = allowed;
+            t.nodeOf.assign(allowed.size(), 0);
+        }
+        return t;
+    }();
+    return topo;
+}
+
+// Pins the calling thread to the worker-th CPU in node order. Returns false,
+// and warns once per process, when the thread could not be pinned.
+static bool pinToCpu(int worker) {
+#ifdef __linux__
+    const CpuTopology& topo = cpuTopology();
+    int cpu = topo.cpus[worker % topo.cpus.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+    if (rc == 0) return true;
+    static once_flag warned;
+    call_once(warned, [&]() {
+        cerr << "warning: cannot pin thread to CPU " << cpu << ": " << strerror(rc)
+             << "; running unpinned\n";
+    });
+    return false;
+#else
+    (void)worker;
+    return false;
+#endif
+}
+
+/* 
+   Stratified sampling over (first player, first focus).
+   Every stratum is equally likely under the real rules, so proportional
+   allocation gives each one games/strata runs. The stratified estimate
+   of each seat's win rate removes the between-strata variance that plain
+   Monte Carlo carries.
+    */
+static void runStratified(long games, unsigned seed) {
+    GameConfig base = headlessConfig(4);
+
+    const int seats = base.numBots;
+    const int strata = seats * Game::numFocusCards;
+    const long perStratum = max(2L, games / strata);
+
+    mt19937 seeds(seed);
+    // wins[h][s] = wins of seat s in stratum h
+    vector<vector<long>> wins(strata, vector<long>(seats, 0));
+
+    for (int h = 0; h < strata; ++h) {
+        GameConfig cfg = base;
+        cfg.firstPlayer = h / Game::numFocusCards;
+        cfg.firstFocus = h % Game::numFocusCards;
+        for (long i = 0; i < perStratum; ++i) {
+            cfg.seed = seeds();
+            Game game(cfg);
+            GameResult res = game.play();
+            if (res.winner >= 0) wins[h][res.winner]++;
+        }
+    }
+
+    const long total = perStratum * strata;
+    const double w = 1.0 / strata;
+    cout << "Stratified run: " << total << " games, " << strata
+         << " strata (first player x first focus), " << perStratum << " per stratum\n";
+    cout << "seat  win-rate  std-err(strat)  std-err(plain)  variance-reduction\n";
+
+    for (int s = 0; s < seats; ++s) {
+        double est = 0.0, varStrat = 0.0;
+        for (int h = 0; h < strata; ++h) {
+            double p = (double)wins[h][s] / perStratum;
+            est += w * p;
+            // unbiased within-stratum variance of a Bernoulli mean
+            varStrat += w * w * p * (1.0 - p) / (perStratum - 1);
+        }
+        double varPlain = est * (1.0 - est) / (total - 1);
+        printf("%4d  %8.4f  %14.5f  %14.5f  %17.2fx\n", s, est,
+               sqrt(varStrat), sqrt(varPlain),
+               varStrat > 0 ? varPlain / varStrat : 0.0);
+    }
+}
+
+/* 
+   Importance sampling for rare events. The bomb roll and bot question
+   probabilities are biased toward the target event and each game is
+   reweighted by its likelihood ratio.
+     "survivor": the winner survived two bombs (about 1 game in 3)
+     "rout":     the game ended in the minimum number of rounds (about 3%)
+     "marathon": the game lasted 17 rounds or more (a few per million)
+   The effective sample size is reported over the weights of the event
+   hits, which are the terms the estimate is built from, and over all
+   games, which misses with large weights can drag far down.
+    */
+static bool rareEventHit(const string& event, const GameResult& res, int seats) {
+    if (event == "survivor") return res.winnerBombsSurvived >= 2;
+    if (event == "marathon") return res.rounds >= 17;
+    return res.rounds == seats - 1;
+}
+
+static void runRareEvent(long games, unsigned seed, const string& event,
+                         double bombQ, double questionQ) {
+    GameConfig cfg = headlessConfig(4);
+    cfg.bombProposal = bombQ;
+    cfg.questionProposal = questionQ;
+
+    mt19937 seeds(seed);
+    double sumW = 0.0, sumW2 = 0.0, sumWI = 0.0, sumWI2 = 0.0;
+    long hits = 0;
+
+    for (long i = 0; i < games; ++i) {
+        cfg.seed = seeds();
+        Game game(cfg);
+        GameResult res = game.play();
+        double wgt = exp(res.logWeight);
+        sumW += wgt;
+        sumW2 += wgt * wgt;
+        if (rareEventHit(event, res, cfg.numBots)) {
+            hits++;
+            sumWI += wgt;
+            sumWI2 += wgt * wgt;
+        }
+    }
+
+    double est = sumWI / games;
+    double var = (sumWI2 / games - est * est) / (games - 1);
+    cout << "Importance sampling: " << games << " games, proposal bomb p=" << bombQ
+         << ", bot question p=" << questionQ << "\n";
+    printf("P(%s) = %.6g  (std-err %.3g)\n", event.c_str(), est, sqrt(max(var, 0.0)));
+    printf("event hits: %ld, mean weight: %.4f, effective sample size: %.0f of the hits, "
+           "%.0f of all games\n", hits, sumW / games, sumWI2 > 0 ? sumWI * sumWI / sumWI2 : 0.0,
+           sumW2 > 0 ? sumW * sumW / sumW2 : 0.0);
+}
+
+/* 
+   Duplicate-format tournament.
+   Each deal seed (shuffles, focus cards, bomb rolls) is replayed once per
+   seat rotation, so every bot profile plays every seat on the same cards.
+   A profile's score on a deal is its result in each seat minus the average
+   result of that seat over all rotations of the deal. Rotations of a deal
+   run back to back so the deal's tables stay hot in cache.
+    */
+static void runDuplicate(long deals, unsigned seed, const vector<int>& profiles) {
+    const int seats = (int)profiles.size();
+    GameConfig cfg = headlessConfig(seats);
+    cfg.seatQuestionPercent.resize(seats);
+
+    mt19937 seeds(seed);
+    vector<double> score(seats, 0.0), scoreSq(seats, 0.0);
+    vector<long> wins(seats, 0);
+    // won[r][s] = 1 if the seat s player won rotation r
+    vector<vector<int>> won(seats, vector<int>(seats, 0));
+
+    for (long d = 0; d < deals; ++d) {
+        cfg.seed = seeds();
+        for (int r = 0; r < seats; ++r) {
+            for (int s = 0; s < seats; ++s)
+                cfg.seatQuestionPercent[s] = profiles[(s + r) % seats];
+            Game game(cfg);
+            GameResult res = game.play();
+            fill(won[r].begin(), won[r].end(), 0);
+            if (res.winner >= 0) won[r][res.winner] = 1;
+        }
+
+        vector<double> dealScore(seats, 0.0);
+        for (int s = 0; s < seats; ++s) {
+            double seatMean = 0.0;
+            for (int r = 0; r < seats; ++r) seatMean += won[r][s];
+            seatMean /= seats;
+            for (int r = 0; r < seats; ++r) {
+                int profile = (s + r) % seats;
+                dealScore[profile] += won[r][s] - seatMean;
+                wins[profile] += won[r][s];
+            }
+        }
+        for (int p = 0; p < seats; ++p) {
+            score[p] += dealScore[p];
+            scoreSq[p] += dealScore[p] * dealScore[p];
+        }
+    }
+
+    cout << "Duplicate tournament: " << deals << " deals x " << seats << " rotations\n";
+    cout << "bot  question%  wins  score/deal  std-err\n";
+    for (int p = 0; p < seats; ++p) {
+        double mean = score[p] / deals;
+        double var = deals > 1 ? (scoreSq[p] / deals - mean * mean) / (deals - 1) : 0.0;
+        printf("%3d  %9d  %4ld  %+10.4f  %7.4f\n", p + 1, profiles[p], wins[p], mean,
+               sqrt(max(var, 0.0)));
+    }
+}
+
+/* 
+   Hand-equity table generator.
+   For every opening hand (counts of Sun, Moon, Star, Magic adding up to 5)
+   and first focus card, estimates the chance the holder wins the game
+   against the reference bots, plus the hand's truthful-play capacity
+   (focus + Magic cards). Sun, Moon and Star are interchangeable in the
+   deck, so only focus Sun is simulated and the other focus cards reuse
+   those results with the counts permuted. Hands are spread over threads.
+    */
+// The Star count is implied (the hand has 5 cards)
+static int handEquityIndex(int sun, int moon, int magic) {
+    return (sun * 6 + moon) * 3 + magic;
+}
+
+static void runEquityTable(long gamesPerHand, unsigned seed, const string& path) {
+    vector<vector<int>> hands;
+    for (int magic = 0; magic <= 2; ++magic)
+        for (int sun = 0; sun <= 5 - magic; ++sun)
+            for (int moon = 0; moon <= 5 - magic - sun; ++moon)
+                hands.push_back({sun, moon, 5 - magic - sun - moon, magic});
+
+    // sunWin[h] = win rate of hands[h] with focus Sun (focus index 0).
+    // Each worker fills its own partial list on its own node; they are
+    // merged once at the end.
+    vector<double> sunWin(hands.size(), 0.0);
+    unsigned workers = max(1u, thread::hardware_concurrency());
+    vector<vector<pair<size_t, double>>> partial(workers);
+    vector<thread> pool;
+    for (unsigned w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w]() {
+            pinToCpu((int)w);
+            vector<pair<size_t, double>> local;
+            GameConfig cfg = headlessConfig(4);
+            cfg.firstFocus = 0;
+            mt19937 seeds(seed + w);
+            for (size_t h = w; h < hands.size(); h += workers) {
+                cfg.firstHandCounts = hands[h];
+                long wins = 0;
+                for (long i = 0; i < gamesPerHand; ++i) {
+                    cfg.seed = seeds();
+                    Game game(cfg);
+                    if (game.play().winner == 0) wins++;
+                }
+                local.emplace_back(h, (double)wins / gamesPerHand);
+            }
+            partial[w] = move(local);
+        });
+    }
+    for (auto& t : pool) t.join();
+    for (const auto& part : partial)
+        for (const auto& hw : part) sunWin[hw.first] = hw.second;
+
+    const int size = handEquityIndex(5, 5, 2) + 1;
+    vector<vector<double>> win(Game::numFocusCards, vector<double>(size, 0.0));
+    vector<vector<int>> capacity(Game::numFocusCards, vector<int>(size, 0));
+    for (size_t h = 0; h < hands.size(); ++h) {
+        const vector<int>& c = hands[h];
+        int idx = handEquityIndex(c[0], c[1], c[3]);
+        for (int f = 0; f < Game::numFocusCards; ++f) {
+            // the hand with focus f plays like the hand with c[0] and c[f] swapped under focus Sun
+            vector<int> asSun = c;
+            swap(asSun[0], asSun[f]);
+            size_t src = find(hands.begin(), hands.end(), asSun) - hands.begin();
+            win[f][idx] = sunWin[src];
+            capacity[f][idx] = c[f] + c[3];
+        }
+    }
+
+    ofstream file(path);
+    if (!file) throw runtime_error("Cannot write " + path);
+    file << "// Generated by: bluffbar --equity-table " << gamesPerHand << "\n"
+         << "// Opening-hand equity per first focus card (Sun, Moon, Star).\n"
+         << "#pragma once\n\n"
+         << "// The Star count is implied (the hand has 5 cards)\n"
+         << "constexpr int handEquityIndex(int sun, int moon, int magic) {\n"
+         << "    return (sun * 6 + moon) * 3 + magic;\n"
+         << "}\n\n"
+         << "constexpr float handWinRate[3][" << size << "] = {\n";
+    for (int f = 0; f < Game::numFocusCards; ++f) {
+        file << "  {";
+        char buf[16];
+        for (int i = 0; i < size; ++i) {
+            snprintf(buf, sizeof buf, "%.4ff", win[f][i]);
+            file << (i ? "," : "") << (i % 12 ? "" : "\n   ") << buf;
+        }
+        file << "},\n";
+    }
+    file << "};\n\n"
+         << "constexpr unsigned char handTruthfulCapacity[3][" << size << "] = {\n";
+    for (int f = 0; f < Game::numFocusCards; ++f) {
+        file << "  {";
+        for (int i = 0; i < size; ++i)
+            file << (i ? "," : "") << (i % 24 ? "" : "\n   ") << capacity[f][i];
+        file << "},\n";
+    }
+    file << "};\n";
+
+    cout << "Wrote " << hands.size() << " hands x " << Game::numFocusCards
+         << " focus cards to " << path << " (" << gamesPerHand << " games per hand)\n";
+}
+
+/* 
+   Macro-step simulator.
+   A round-level state is (alive mask, survived bombs per seat, starter),
+   packed into an int. The first time a state is reached, the exact rules
+   engine plays samplesPerState rounds from it and the outcome histogram
+   becomes an alias table (Vose), so every later round is one O(1) draw.
+    */
+struct AliasTable {
+    vector<double> prob;
+    vector<int> alias;
+    vector<int> outcome;
+
+    void build(const unordered_map<int, long>& counts) {
+        int n = (int)counts.size();
+        long total = 0;
+        outcome.clear();
+        vector<double> scaled;
+        for (const auto& kv : counts) {
+            outcome.push_back(kv.first);
+            scaled.push_back((double)kv.second);
+            total += kv.second;
+        }
+        prob.assign(n, 1.0);
+        alias.assign(n, 0);
+        vector<int> small, large;
+        for (int i = 0; i < n; ++i) {
+            scaled[i] = scaled[i] * n / total;
+            (scaled[i] < 1.0 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            int s = small.back(); small.pop_back();
+            int l = large.back(); large.pop_back();
+            prob[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            (scaled[l] < 1.0 ? small : large).push_back(l);
+        }
+    }
+
+    int sample(mt19937& rng) const {
+        int i = uniform_int_distribution<int>(0, (int)outcome.size() - 1)(rng);
+        return uniform_real_distribution<double>(0.0, 1.0)(rng) < prob[i] ? outcome[i]
+                                                                           : outcome[alias[i]];
+    }
+};
+
+class MacroSimulator {
+private:
+    GameConfig base;
+    long samplesPerState;
+    mt19937 rng;
+    unordered_map<int, AliasTable> tables;
+    long exactRounds = 0;
+
+    // bits 0-3 alive, 4-11 strikes (2 bits per seat), 12-13 starter
+    static int pack(unsigned alive, const vector<int>& strikes, int starter) {
+        int key = (int)alive;
+        for (int i = 0; i < (int)strikes.size(); ++i) key |= strikes[i] << (4 + 2 * i);
+        return key | starter << 12;
+    }
+
+    const AliasTable& tableFor(int key) {
+        auto it = tables.find(key);
+        if (it != tables.end()) return it->second;
+
+        unsigned alive = key & 0xF;
+        vector<int> strikes(base.numBots);
+        for (int i = 0; i < base.numBots; ++i) strikes[i] = key >> (4 + 2 * i) & 3;
+        int starter = key >> 12 & 3;
+
+        unordered_map<int, long> counts;
+        GameConfig cfg = base;
+        for (long i = 0; i < samplesPerState; ++i) {
+            cfg.seed = rng();
+            Game game(cfg);
+            game.setRoundState(alive, strikes, starter);
+            game.playRound();
+            vector<int> after(base.numBots);
+            for (int s = 0; s < base.numBots; ++s) after[s] = game.strikes(s);
+            counts[pack(game.aliveMask(), after, game.nextStarter())]++;
+        }
+        exactRounds += samplesPerState;
+        AliasTable& table = tables[key];
+        table.build(counts);
+        return table;
+    }
+
+public:
+    MacroSimulator(const GameConfig& cfg, long samples, unsigned seed)
+        : base(cfg), samplesPerState(samples), rng(seed) {}
+
+    // Plays one game round by round; returns the winning seat and counts rounds
+    int playGame(int& rounds) {
+        int key = pack((1u << base.numBots) - 1, vector<int>(base.numBots, 0),
+                       uniform_int_distribution<int>(0, base.numBots - 1)(rng));
+        rounds = 0;
+        while (__builtin_popcount(key & 0xF) > 1) {
+            key = tableFor(key).sample(rng);
+            rounds++;
+        }
+        return (key & 0xF) ? __builtin_ctz(key & 0xF) : -1;
+    }
+
+    size_t states() const { return tables.size(); }
+    long roundsSimulatedExactly() const { return exactRounds; }
+};
+
+static void runMacro(long games, unsigned seed, long samplesPerState, bool validate) {
+    GameConfig cfg = headlessConfig(4);
+    const int seats = cfg.numBots;
+
+    MacroSimulator macro(cfg, samplesPerState, seed);
+    vector<long> macroWins(seats, 0);
+    long macroRounds = 0;
+
+    auto t0 = chrono::steady_clock::now();
+    for (long i = 0; i < games; ++i) {
+        int rounds;
+        int w = macro.playGame(rounds);
+        if (w >= 0) macroWins[w]++;
+        macroRounds += rounds;
+    }
+    double buildAndRun = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    // second pass times the pure O(1) path once every reachable table exists
+    t0 = chrono::steady_clock::now();
+    long sink = 0;
+    for (long i = 0; i < games; ++i) {
+        int rounds;
+        sink += macro.playGame(rounds) + rounds;
+    }
+    double runOnly = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    cout << "Macro-step: " << games << " games, " << macro.states() << " round states, "
+         << samplesPerState << " exact rounds per state\n";
+    printf("  first pass (incl. tables): %.3fs, table-only pass: %.3fs (%.0f games/s)\n",
+           buildAndRun, runOnly, runOnly > 0 ? games / runOnly : 0.0);
+    if (sink == -1) cout << "\n";  // keep the timed loop from being optimised away
+
+    if (!validate) {
+        for (int s = 0; s < seats; ++s)
+            printf("  seat %d win-rate %.4f\n", s, (double)macroWins[s] / games);
+        printf("  mean rounds %.3f\n", (double)macroRounds / games);
+        return;
+    }
+
+    // Validation: the same number of games through the per-turn engine
+    mt19937 seeds(seed ^ 0x5bd1e995u);
+    vector<long> fineWins(seats, 0);
+    long fineRounds = 0;
+    t0 = chrono::steady_clock::now();
+    for (long i = 0; i < games; ++i) {
+        cfg.seed = seeds();
+        Game game(cfg);
+        GameResult res = game.play();
+        if (res.winner >= 0) fineWins[res.winner]++;
+        fineRounds += res.rounds;
+    }
+    double fine = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    printf("  per-turn engine: %.3fs (%.0f games/s), speed-up %.1fx\n",
+           fine, games / fine, runOnly > 0 ? fine / runOnly : 0.0);
+    cout << "seat  macro   fine    diff/std-err\n";
+    for (int s = 0; s < seats; ++s) {
+        double pm = (double)macroWins[s] / games, pf = (double)fineWins[s] / games;
+        double se = sqrt((pm * (1 - pm) + pf * (1 - pf)) / games);
+        printf("%4d  %.4f  %.4f  %+6.2f\n", s, pm, pf, se > 0 ? (pm - pf) / se : 0.0);
+    }
+    printf("mean rounds: macro %.3f, fine %.3f\n",
+           (double)macroRounds / games, (double)fineRounds / games);
+}
+
+/* 
+   PerfCounter: one hardware counter for the calling thread (Linux
+   perf_event_open). valid() is false where the kernel or container does
+   not allow it, and callers report "n/a".
+    */
+class PerfCounter {
+private:
+    int fd = -1;
+
+public:
+    PerfCounter(uint32_t type, uint64_t config) {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#else
+        (void)type;
+        (void)config;
+#endif
+    }
+
+    ~PerfCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    bool valid() const { return fd >= 0; }
+
+    uint64_t read() const {
+        uint64_t value = 0;
+#ifdef __linux__
+        if (fd >= 0 && ::read(fd, &value, sizeof value) != (ssize_t)sizeof value) value = 0;
+#endif
+        return value;
+    }
+};
+
+static PerfCounter cacheMissCounter() {
+#ifdef __linux__
+    return PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#else
+    return PerfCounter(0, 0);
+#endif
+}
+
+// Memory accesses resolved at NUMA-node level; misses there are remote accesses
+static PerfCounter nodeCounter(bool missesOnly) {
+#ifdef __linux__
+    uint64_t result = missesOnly ? PERF_COUNT_HW_CACHE_RESULT_MISS : PERF_COUNT_HW_CACHE_RESULT_ACCESS;
+    return PerfCounter(PERF_TYPE_HW_CACHE,
+                       PERF_COUNT_HW_CACHE_NODE | PERF_COUNT_HW_CACHE_OP_READ << 8 | result << 16);
+#else
+    (void)missesOnly;
+    return PerfCounter(0, 0);
+#endif
+}
+
+static PerfCounter tlbMissCounter() {
+#ifdef __linux__
+    return PerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                           | PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+#else
+    return PerfCounter(0, 0);
+#endif
+}
+
+static PerfCounter cacheRefCounter() {
+#ifdef __linux__
+    return PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+#else
+    return PerfCounter(0, 0);
+#endif
+}
+
+/* 
+   BENCHMARKS
+   Repetitions of all benchmarks are interleaved (A B C A B C ...) so slow
+   drifts on a shared box hit every benchmark alike, the thread is pinned
+   to one CPU, and each benchmark reports its median with a bootstrap 95%
+   confidence interval. Results are saved as JSON; --bench-compare flags
+   only changes whose confidence interval excludes "no change".
+    */
+static double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+// Bootstrap 95% interval of stat(a, b) over resamples of a and b
+template<typename Stat>
+static pair<double, double> bootstrapCI(const vector<double>& a, const vector<double>& b,
+                                        Stat stat, unsigned seed) {
+    const int resamples = 2000;
+    mt19937 rng(seed);
+    vector<double> stats, ra(a.size()), rb(b.size());
+    for (int i = 0; i < resamples; ++i) {
+        for (auto& x : ra) x = a[uniform_int_distribution<size_t>(0, a.size() - 1)(rng)];
+        for (auto& x : rb) x = b.empty() ? 0.0 : b[uniform_int_distribution<size_t>(0, b.size() - 1)(rng)];
+        stats.push_back(stat(ra, rb));
+    }
+    sort(stats.begin(), stats.end());
+    return {stats[resamples * 25 / 1000], stats[resamples * 975 / 1000]};
+}
+
+struct BenchResult {
+    string name;
+    vector<double> samples;   // ns per operation, one per repetition
+    uint64_t tlbMisses = 0;   // dTLB load misses over all timed repetitions
+};
+
+struct Benchmark {
+    string name;
+    long opsPerRep;
+    function<long(long, mt19937&)> run;   // runs n ops, returns a value to keep the work alive
+};
+
+static vector<Benchmark> benchmarkSuite() {
+    GameConfig headless = headlessConfig(4);
+
+    return {
+        {"deck_reset_deal", 20000, [](long n, mt19937& rng) {
+            Deck<string> deck(rng);
+            long sink = 0;
+            for (long i = 0; i < n; ++i) {
+                deck.reset();
+                for (int p = 0; p < 4; ++p) sink += (long)deck.deal(5).size();
+            }
+            return sink;
+        }},
+        {"headless_game", 2000, [headless](long n, mt19937& rng) {
+            GameConfig cfg = headless;
+            long sink = 0;
+            for (long i = 0; i < n; ++i) {
+                cfg.seed = rng();
+                Game game(cfg);
+                sink += game.play().rounds;
+            }
+            return sink;
+        }},
+        {"headless_round", 5000, [headless](long n, mt19937& rng) {
+            GameConfig cfg = headless;
+            cfg.seed = rng();
+            Game game(cfg);
+            long sink = 0;
+            for (long i = 0; i < n; ++i) {
+                game.setRoundState(0xF, {0, 0, 0, 0}, (int)(i & 3));
+                game.playRound();
+                sink += game.aliveMask();
+            }
+            return sink;
+        }},
+    };
+}
+
+static void writeBenchJson(const string& path, const vector<BenchResult>& results) {
+    ofstream file(path);
+    if (!file) throw runtime_error("Cannot write " + path);
+    file << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        file << "    {\"name\": \"" << results[i].name << "\", \"unit\": \"ns/op\", \"samples\": [";
+        for (size_t j = 0; j < results[i].samples.size(); ++j)
+            file << (j ? ", " : "") << results[i].samples[j];
+        file << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+}
+
+// Reads the files written by writeBenchJson (one benchmark per line)
+static vector<BenchResult> readBenchJson(const string& path) {
+    ifstream file(path);
+    if (!file) throw runtime_error("Cannot read " + path);
+    vector<BenchResult> results;
+    string line;
+    while (getline(file, line)) {
+        size_t n = line.find("\"name\": \"");
+        size_t open = line.find('[');
+        size_t close = line.find(']');
+        if (n == string::npos || open == string::npos || close == string::npos) continue;
+        BenchResult r;
+        n += 9;
+        r.name = line.substr(n, line.find('"', n) - n);
+        string list = line.substr(open + 1, close - open - 1);
+        replace(list.begin(), list.end(), ',', ' ');
+        istringstream in(list);
+        double v;
+        while (in >> v) r.samples.push_back(v);
+        if (!r.samples.empty()) results.push_back(r);
+    }
+    return results;
+}
+
+// Average and peak bytes per live table, sampled at every round boundary
+static void reportTableMemory() {
+    GameConfig cfg = headlessConfig(4);
+    mt19937 seeds(7);
+
+    MemoryUsage sum, peak;
+    long samples = 0;
+    for (int g = 0; g < 200; ++g) {
+        cfg.seed = seeds();
+        Game game(cfg);
+        game.setRoundState(0xF, {0, 0, 0, 0}, g & 3);
+        while (__builtin_popcount(game.aliveMask()) > 1) {
+            MemoryUsage m = game.memoryUsage();
+            sum.table += m.table;
+            sum.players += m.players;
+            sum.strikes += m.strikes;
+            sum.lastPlayed += m.lastPlayed;
+            sum.deck += m.deck;
+            sum.config += m.config;
+            if (m.total() > peak.total()) peak = m;
+            samples++;
+            game.playRound();
+        }
+    }
+    printf("bytes per table: %.0f average, %zu peak (table %zu, players %zu, strikes %zu, "
+           "last plays %zu, deck %zu, config %zu)\n",
+           (double)sum.total() / samples, peak.total(), peak.table, peak.players,
+           peak.strikes, peak.lastPlayed, peak.deck, peak.config);
+}
+
+static void runBench(const string& path, int reps) {
+    pinToCpu(0);
+    vector<Benchmark> suite = benchmarkSuite();
+    vector<BenchResult> results(suite.size());
+    mt19937 rng(12345);   // fixed, so two runs do the same work
+    long sink = 0;
+    PerfCounter tlb = tlbMissCounter();
+
+    for (size_t b = 0; b < suite.size(); ++b) {
+        results[b].name = suite[b].name;
+        sink += suite[b].run(suite[b].opsPerRep / 10, rng);   // warm-up
+    }
+    for (int r = 0; r < reps; ++r) {
+        for (size_t b = 0; b < suite.size(); ++b) {
+            uint64_t tlb0 = tlb.read();
+            auto t0 = chrono::steady_clock::now();
+            sink += suite[b].run(suite[b].opsPerRep, rng);
+            double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+            results[b].samples.push_back(ns / suite[b].opsPerRep);
+            results[b].tlbMisses += tlb.read() - tlb0;
+        }
+    }
+
+    cout << "benchmark            median ns/op   95% CI                dTLB misses/op\n";
+    for (size_t b = 0; b < results.size(); ++b) {
+        const BenchResult& r = results[b];
+        auto ci = bootstrapCI(r.samples, {}, [](const vector<double>& a, const vector<double>&) {
+            return median(a);
+        }, 1);
+        printf("%-20s %12.1f   %-20s  ", r.name.c_str(), median(r.samples),
+               ("[" + to_string((long)ci.first) + ", " + to_string((long)ci.second) + "]").c_str());
+        if (tlb.valid()) printf("%.2f\n", (double)r.tlbMisses / (suite[b].opsPerRep * reps));
+        else printf("n/a\n");
+    }
+    reportTableMemory();
+    writeBenchJson(path, results);
+    cout << "Wrote " << path << (sink == -1 ? " " : "") << "\n";
+}
+
+static void runBenchCompare(const string& basePath, const string& newPath) {
+    vector<BenchResult> base = readBenchJson(basePath), now = readBenchJson(newPath);
+    cout << "benchmark            base ns/op   new ns/op   change   95% CI           verdict\n";
+    for (const auto& n : now) {
+        auto it = find_if(base.begin(), base.end(), [&](const BenchResult& b) { return b.name == n.name; });
+        if (it == base.end()) {
+            printf("%-20s (not in %s)\n", n.name.c_str(), basePath.c_str());
+            continue;
+        }
+        auto ratio = [](const vector<double>& a, const vector<double>& b) {
+            return median(b) / median(a) - 1.0;
+        };
+        auto ci = bootstrapCI(it->samples, n.samples, ratio, 1);
+        const char* verdict = ci.first > 0 ? "REGRESSION" : ci.second < 0 ? "improvement" : "no change";
+        printf("%-20s %10.1f  %10.1f  %+6.1f%%   [%+5.1f%%, %+5.1f%%]  %s\n", n.name.c_str(),
+               median(it->samples), median(n.samples), 100 * ratio(it->samples, n.samples),
+               100 * ci.first, 100 * ci.second, verdict);
+    }
+}
+
+/* 
+   Multi-core scaling benchmark.
+   Runs independent headless tables on 1, 2, 4 ... N pinned threads and
+   reports throughput, parallel efficiency against one thread, and the
+   cache-miss rate overall and per thread (lowest and highest). Each
+   thread keeps `tables` games live at once and steps them a round at a
+   time in turn, like a server shard would.
+    */
+struct ScaleSample {
+    long games = 0;
+    uint64_t misses = 0, refs = 0;
+    uint64_t remote = 0, nodeAccesses = 0;
+    bool counted = false, nodeCounted = false;
+    bool pinned = false;
+};
+
+static ScaleSample scaleWorker(int cpu, int seats, int tables, long games, unsigned seed) {
+    bool pinned = pinToCpu(cpu);
+    GameConfig cfg = headlessConfig(seats);
+    mt19937 seeds(seed);
+
+    // state built by the worker itself, so it lands in the worker's memory
+    vector<unique_ptr<Game>> live(tables);
+    auto fresh = [&]() {
+        cfg.seed = seeds();
+        auto game = make_unique<Game>(cfg);
+        game->setRoundState((1u << seats) - 1, vector<int>(seats, 0),
+                            uniform_int_distribution<int>(0, seats - 1)(seeds));
+        return game;
+    };
+    for (auto& g : live) g = fresh();
+
+    PerfCounter misses = cacheMissCounter(), refs = cacheRefCounter();
+    PerfCounter remote = nodeCounter(true), nodeAccesses = nodeCounter(false);
+    ScaleSample sample;
+    sample.pinned = pinned;
+    while (sample.games < games) {
+        for (auto& g : live) {
+            g->playRound();
+            if (__builtin_popcount(g->aliveMask()) <= 1) {
+                sample.games++;
+                g = fresh();
+            }
+        }
+    }
+    sample.counted = misses.valid() && refs.valid();
+    sample.misses = misses.read();
+    sample.refs = refs.read();
+    sample.nodeCounted = remote.valid() && nodeAccesses.valid();
+    sample.remote = remote.read();
+    sample.nodeAccesses = nodeAccesses.read();
+    return sample;
+}
+
+static void runScale(long gamesPerThread, int maxThreads) {
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    cout << "Scaling: " << gamesPerThread << " games per thread, up to " << maxThreads
+         << " threads, " << cpuTopology().nodes << " NUMA node(s)\n";
+    cout << "seats  tables/thread  threads   games/s  efficiency  cache-miss% [per-thread min-max]  remote%\n";
+    for (int seats = 2; seats <= 4; ++seats) {
+        for (int tables : {1, 16, 256}) {
+            double single = 0.0;
+            for (int threads : threadCounts) {
+                vector<ScaleSample> samples(threads);
+                vector<thread> pool;
+                auto t0 = chrono::steady_clock::now();
+                for (int t = 0; t < threads; ++t)
+                    pool.emplace_back([&, t]() {
+                        samples[t] = scaleWorker(t, seats, tables, gamesPerThread, 1000u * t + seats);
+                    });
+                for (auto& th : pool) th.join();
+                double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+                long games = 0;
+                uint64_t missSum = 0, refSum = 0, remoteSum = 0, nodeSum = 0;
+                bool counted = true, nodeCounted = true;
+                int unpinned = 0;
+                double minMiss = 100.0, maxMiss = 0.0;
+                for (const auto& sm : samples) {
+                    unpinned += !sm.pinned;
+                    if (sm.refs > 0) {
+                        double miss = 100.0 * sm.misses / sm.refs;
+                        minMiss = min(minMiss, miss);
+                        maxMiss = max(maxMiss, miss);
+                    }
+                    games += sm.games;
+                    missSum += sm.misses;
+                    refSum += sm.refs;
+                    remoteSum += sm.remote;
+                    nodeSum += sm.nodeAccesses;
+                    counted = counted && sm.counted;
+                    nodeCounted = nodeCounted && sm.nodeCounted;
+                }
+                double rate = games / secs;
+                if (threads == 1) single = rate;
+                printf("%5d  %13d  %7d  %8.0f  %9.1f%%  ", seats, tables, threads, rate,
+                       100.0 * rate / (threads * single));
+                if (counted && refSum > 0)
+                    printf("%11.2f%% [%6.2f%% - %6.2f%%]  ", 100.0 * missSum / refSum, minMiss, maxMiss);
+                else printf("%32s  ", "n/a");
+                if (nodeCounted && nodeSum > 0) printf("%6.2f%%", 100.0 * remoteSum / nodeSum);
+                else printf("%7s", "n/a");
+                if (unpinned) printf("  (%d thread(s) unpinned)", unpinned);
+                printf("\n");
+            }
+        }
+    }
+}
+
+/* 
+   Game records and bulk verification.
+   A record is one line: seed, seats, bombOneIn, botQuestionPercent, then
+   the claimed winner, rounds and event digest. The digest covers every
+   question with its reveal, every bomb roll outcome and every death, so
+   re-executing the seed through the rules engine checks all of them.
+   Verification splits the file across pinned threads.
+    */
+struct GameRecord {
+    unsigned seed = 0;
+    int seats = 4, bombOneIn = 3, questionPercent = 30;
+    int winner = -1, rounds = 0;
+    uint64_t digest = 0;
+    long line = 0;   // line in the record file, for messages
+};
+
+static GameConfig recordConfig(const GameRecord& r) {
+    GameConfig cfg = headlessConfig(r.seats);
+    cfg.bombOneIn = r.bombOneIn;
+    cfg.botQuestionPercent = r.questionPercent;
+    cfg.seed = r.seed;
+    return cfg;
+}
+
+static void runRecord(long games, unsigned seed, const string& path) {
+    ofstream file(path);
+    if (!file) throw runtime_error("Cannot write " + path);
+    mt19937 seeds(seed);
+    for (long i = 0; i < games; ++i) {
+        GameRecord r;
+        r.seed = seeds();
+        Game game(recordConfig(r));
+        GameResult res = game.play();
+        char line[96];
+        snprintf(line, sizeof line, "%u %d %d %d %d %d %016llx\n", r.seed, r.seats, r.bombOneIn,
+                 r.questionPercent, res.winner, res.rounds, (unsigned long long)res.digest);
+        file << line;
+    }
+    cout << "Recorded " << games << " games to " << path << "\n";
+}
+
+// Parses one record line; false if the line is not a record
+static bool parseRecord(const string& line, GameRecord& r) {
+    unsigned long long digest = 0;
+    if (sscanf(line.c_str(), "%u %d %d %d %d %d %llx", &r.seed, &r.seats, &r.bombOneIn,
+               &r.questionPercent, &r.winner, &r.rounds, &digest) != 7)
+        return false;
+    r.digest = digest;
+    return true;
+}
+
+static vector<GameRecord> readRecords(const string& path) {
+    ifstream file(path);
+    if (!file) throw runtime_error("Cannot read " + path);
+    vector<GameRecord> records;
+    string line;
+    for (long lineNo = 1; getline(file, line); ++lineNo) {
+        if (line.find_first_not_of(" \t\r") == string::npos) continue;   // blank lines are not records
+        GameRecord r;
+        if (!parseRecord(line, r))
+            throw runtime_error("Bad record on line " + to_string(lineNo));
+        r.line = lineNo;
+        records.push_back(r);
+    }
+    return records;
+}
+
+static void runVerify(const string& path, int threads) {
+    vector<GameRecord> records = readRecords(path);
+
+    vector<vector<size_t>> mismatches(threads);
+    vector<thread> pool;
+    auto t0 = chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            pinToCpu(t);
+            size_t begin = records.size() * t / threads, end = records.size() * (t + 1) / threads;
+            for (size_t i = begin; i < end; ++i) {
+                const GameRecord& r = records[i];
+                try {
+                    Game game(recordConfig(r));
+                    GameResult res = game.play();
+                    if (res.winner != r.winner || res.rounds != r.rounds || res.digest != r.digest)
+                        mismatches[t].push_back(i);
+                } catch (const exception&) {
+                    mismatches[t].push_back(i);   // records with impossible rules fail too
+                }
+            }
+        });
+    }
+    for (auto& th : pool) th.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    size_t bad = 0;
+    for (const auto& m : mismatches) {
+        for (size_t i : m) {
+            if (bad < 20) cout << "MISMATCH line " << records[i].line << " (seed " << records[i].seed << ")\n";
+            bad++;
+        }
+    }
+    printf("Verified %zu games on %d thread(s) in %.2fs (%.0f games/s): %zu mismatch(es)\n",
+           records.size(), threads, secs, secs > 0 ? records.size() / secs : 0.0, bad);
+}
+
+/* 
+   PGO training workload.
+   A fixed mix of engine work for building profile-guided binaries:
+   bot-only tables, and tables with a human seat fed by a scripted
+   console (valid answers with some mistyped ones, so the input error
+   paths run too). All of it runs with the flight recorder on and
+   narration formatted into a null stream, as on a headless server.
+   It prints the branch-level rates it produced and, given a reference,
+   how far each rate is from it. The reference is either a --record file,
+   whose games are re-executed to get the same rates, or "key value"
+   lines supplied from elsewhere (e.g. measured on production tables).
+    */
+static string trainingScript(mt19937& rng, int tokens) {
+    static constexpr const char* typos[] = {"x", "0", "9", "-1", "abc"};
+    string script;
+    for (int i = 0; i < tokens; ++i) {
+        int r = uniform_int_distribution<int>(0, 99)(rng);
+        if (r < 5) script += typos[r];
+        else if (r < 25) script += (r < 15 ? "y" : "n");
+        else script += to_string(uniform_int_distribution<int>(1, 3)(rng));
+        script += '\n';   // one answer per line, as typed at the console
+    }
+    return script;
+}
+
+// Totals behind the workload rates that training is compared on
+struct WorkloadCounts {
+    long games = 0, rounds = 0, turns = 0, questions = 0, bombs = 0;
+
+    void add(const GameResult& res) {
+        games++;
+        rounds += res.rounds;
+        turns += res.turns;
+        questions += res.questions;
+        bombs += res.bombs;
+    }
+
+    vector<pair<string, double>> rates() const {
+        return {
+            {"rounds_per_game", (double)rounds / games},
+            {"turns_per_round", (double)turns / rounds},
+            {"questions_per_round", (double)questions / rounds},
+            {"bombs_per_question", questions ? (double)bombs / questions : 0.0},
+        };
+    }
+};
+
+static map<string, double> trainingReference(const string& path) {
+    ifstream file(path);
+    if (!file) throw runtime_error("Cannot read " + path);
+    string first;
+    while (getline(file, first) && first.find_first_not_of(" \t\r") == string::npos) {}
+    GameRecord probe;
+    map<string, double> reference;
+    if (parseRecord(first, probe)) {
+        // recorded games: replay them, checking each one still matches its record
+        WorkloadCounts counts;
+        vector<GameRecord> records = readRecords(path);
+        for (size_t i = 0; i < records.size(); ++i) {
+            Game game(recordConfig(records[i]));
+            GameResult res = game.play();
+            if (res.digest != records[i].digest)
+                throw runtime_error("Record on line " + to_string(records[i].line)
+                                    + " does not replay; run --verify " + path);
+            counts.add(res);
+        }
+        if (counts.games == 0) return reference;
+        for (const auto& st : counts.rates()) reference[st.first] = st.second;
+        return reference;
+    }
+    file.seekg(0);
+    string key;
+    double value;
+    while (file >> key >> value) reference[key] = value;
+    return reference;
+}
+
+static void runTraining(long games, unsigned seed, const string& referencePath) {
+    GameConfig bots = headlessConfig(4);
+    GameConfig withHuman = bots;
+    withHuman.humanSeat = true;
+    withHuman.numBots = 3;
+
+    mt19937 seeds(seed);
+    WorkloadCounts counts;
+    long humanGames = 0;
+    for (long i = 0; i < games; ++i) {
+        bool human = i % 10 < 3;   // 30% of tables have a human seat
+        GameConfig cfg = human ? withHuman : bots;
+        cfg.seed = seeds();
+        QueueInput answers;
+        if (human) {
+            answers = QueueInput(trainingScript(seeds, 4000));
+            cfg.input = &answers;
+            humanGames++;
+        }
+        Game game(cfg);
+        counts.add(game.play());
+    }
+
+    cout << "Training workload: " << games << " games (" << humanGames << " with a scripted human)\n";
+    map<string, double> reference;
+    if (!referencePath.empty()) reference = trainingReference(referencePath);
+    for (const auto& st : counts.rates()) {
+        printf("%-22s %10.4f", st.first.c_str(), st.second);
+        auto it = reference.find(st.first);
+        if (it != reference.end() && it->second != 0.0)
+            printf("   reference %10.4f  (%+.1f%%)", it->second, 100.0 * (st.second / it->second - 1.0));
+        printf("\n");
+    }
+}
+
+/* 
+   RNG and shuffle quality harness.
+   Pushes deals through the real Deck with a chosen engine, plus the bomb
+   and question rolls, in parallel with fixed-size counters (constant
+   memory however many deals). Tests:
+     - chi-square of card type by deck position
+     - chi-square of seat 0's hand composition against the exact
+       multivariate hypergeometric probabilities
+     - adjacent positions holding the same type (pairwise correlation)
+     - chi-square of the top card of consecutive deals (deal-to-deal independence)
+     - bomb (1/3) and question (30%) rates, both through the engine's
+       uniform_int_distribution as the game rolls them and through a plain
+       modulo as the old rand() code did
+    */
+
+// Engine adapter for the C library rand(), to test the old code path (single thread only)
+struct CRandEngine {
+    using result_type = unsigned;
+    explicit CRandEngine(unsigned seed) { srand(seed); }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return RAND_MAX; }
+    result_type operator()() { return (result_type)rand(); }
+};
+
+struct QualityCounts {
+    static constexpr int positions = 20, types = 4, hands = 6 * 6 * 3;
+    uint64_t byPosition[positions][types] = {};
+    uint64_t handClass[hands] = {};
+    uint64_t adjacentSame = 0;
+    uint64_t topPair[types][types] = {};
+    uint64_t bombHits = 0, bombModHits = 0, questionHits = 0, questionModHits = 0;
+    uint64_t deals = 0, rolls = 0;
+
+    void merge(const QualityCounts& o) {
+        for (int p = 0; p < positions; ++p)
+            for (int t = 0; t < types; ++t) byPosition[p][t] += o.byPosition[p][t];
+        for (int h = 0; h < hands; ++h) handClass[h] += o.handClass[h];
+        for (int a = 0; a < types; ++a)
+            for (int b = 0; b < types; ++b) topPair[a][b] += o.topPair[a][b];
+        adjacentSame += o.adjacentSame;
+        bombHits += o.bombHits;
+        bombModHits += o.bombModHits;
+        questionHits += o.questionHits;
+        questionModHits += o.questionModHits;
+        deals += o.deals;
+        rolls += o.rolls;
+    }
+};
+
+// Sun 0, Moon 1, Star 2, Magic 3 (second letters differ)
+static int cardType(const string& card) {
+    switch (card[1]) {
+        case 'u': return 0;
+        case 'o': return 1;
+        case 't': return 2;
+        default:  return 3;
+    }
+}
+
+template<typename Engine>
+static void qualityWorker(uint64_t deals, unsigned seed, QualityCounts& c) {
+    Engine rng(seed);
+    Deck<string, Engine> deck(rng);
+    int prevTop = -1;
+    for (uint64_t d = 0; d < deals; ++d) {
+        deck.reset();
+        vector<string> order = deck.deal(QualityCounts::positions);
+        int type[QualityCounts::positions], count[QualityCounts::types] = {};
+        for (int p = 0; p < QualityCounts::positions; ++p) {
+            type[p] = cardType(order[p]);
+            c.byPosition[p][type[p]]++;
+            if (p > 0 && type[p] == type[p - 1]) c.adjacentSame++;
+            if (p < 5) count[type[p]]++;
+        }
+        c.handClass[(count[0] * 6 + count[1]) * 3 + count[3]]++;
+        if (prevTop >= 0) c.topPair[prevTop][type[0]]++;
+        prevTop = type[0];
+
+        // same number of bomb and question rolls as deals
+        c.bombHits += uniform_int_distribution<int>(1, 3)(rng) == 1;
+        c.bombModHits += rng() % 3 == 0;
+        c.questionHits += uniform_int_distribution<int>(0, 99)(rng) < 30;
+        c.questionModHits += rng() % 100 < 30;
+        c.rolls++;
+    }
+    c.deals += deals;
+}
+
+// Upper-tail p-value of a chi-square statistic (Wilson-Hilferty approximation)
+static double chiSquareP(double x, int df) {
+    double k = df;
+    double z = (cbrt(x / k) - (1.0 - 2.0 / (9.0 * k))) / sqrt(2.0 / (9.0 * k));
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+// Two-sided p-value of a binomial rate against p (normal approximation)
+static double rateP(uint64_t hits, uint64_t n, double p) {
+    double z = (hits - n * p) / sqrt(n * p * (1.0 - p));
+    return erfc(fabs(z) / sqrt(2.0));
+}
+
+static double binomial(int n, int k) {
+    if (k < 0 || k > n) return 0.0;
+    double r = 1.0;
+    for (int i = 1; i <= k; ++i) r = r * (n - k + i) / i;
+    return r;
+}
+
+static void printQualityLine(const char* test, double stat, double p) {
+    printf("%-34s %14.3f  p=%.4f  %s\n", test, stat, p, p < 0.001 ? "FAIL" : "ok");
+}
+
+static void runRngQuality(uint64_t deals, const string& engine, int threads) {
+    if (engine == "rand") threads = 1;   // rand() has one global state
+    vector<QualityCounts> partial(threads);
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            pinToCpu(t);
+            uint64_t share = deals * (t + 1) / threads - deals * t / threads;
+            QualityCounts local;   // worker-local, merged once at the end
+            unsigned seed = 0x9E3779B9u * (t + 1);
+            if (engine == "stream") qualityWorker<StreamRng>(share, seed, local);
+            else if (engine == "minstd") qualityWorker<minstd_rand>(share, seed, local);
+            else if (engine == "rand") qualityWorker<CRandEngine>(share, seed, local);
+            else qualityWorker<mt19937>(share, seed, local);
+            partial[t] = local;
+        });
+    }
+    for (auto& th : pool) th.join();
+    QualityCounts c;
+    for (const auto& p : partial) c.merge(p);
+
+    const double typeCount[QualityCounts::types] = {6, 6, 6, 2};
+    const double n = (double)c.deals;
+    cout << "RNG quality: " << c.deals << " deals, engine " << engine << ", " << threads << " thread(s)\n";
+    printf("%-34s %14s  %s\n", "test", "statistic", "p-value");
+
+    double chi = 0.0;
+    for (int p = 0; p < QualityCounts::positions; ++p)
+        for (int t = 0; t < QualityCounts::types; ++t) {
+            double e = n * typeCount[t] / 20.0;
+            chi += (c.byPosition[p][t] - e) * (c.byPosition[p][t] - e) / e;
+        }
+    printQualityLine("card type by position (chi2)", chi, chiSquareP(chi, 19 * 3));
+
+    chi = 0.0;
+    int classes = 0;
+    for (int magic = 0; magic <= 2; ++magic)
+        for (int sun = 0; sun <= 5 - magic; ++sun)
+            for (int moon = 0; moon <= 5 - magic - sun; ++moon) {
+                int star = 5 - magic - sun - moon;
+                double prob = binomial(6, sun) * binomial(6, moon) * binomial(6, star)
+                              * binomial(2, magic) / binomial(20, 5);
+                double e = n * prob;
+                double o = (double)c.handClass[(sun * 6 + moon) * 3 + magic];
+                chi += (o - e) * (o - e) / e;
+                classes++;
+            }
+    printQualityLine("hand composition (chi2)", chi, chiSquareP(chi, classes - 1));
+
+    double sameP = 0.0;
+    for (double k : typeCount) sameP += k * (k - 1) / (20.0 * 19.0);
+    uint64_t pairs = c.deals * (QualityCounts::positions - 1);
+    printQualityLine("adjacent same type (rate)", (double)c.adjacentSame / pairs,
+                     rateP(c.adjacentSame, pairs, sameP));
+
+    // each thread's first deal has no predecessor, so count the pairs themselves
+    chi = 0.0;
+    double pairTotal = 0.0;
+    for (int a = 0; a < QualityCounts::types; ++a)
+        for (int b = 0; b < QualityCounts::types; ++b) pairTotal += c.topPair[a][b];
+    for (int a = 0; a < QualityCounts::types; ++a)
+        for (int b = 0; b < QualityCounts::types; ++b) {
+            double e = pairTotal * typeCount[a] / 20.0 * typeCount[b] / 20.0;
+            chi += (c.topPair[a][b] - e) * (c.topPair[a][b] - e) / e;
+        }
+    // expected counts come from fixed probabilities, so all 16 cells but one are free
+    printQualityLine("top card, deal to deal (chi2)", chi, chiSquareP(chi, 15));
+
+    printQualityLine("bomb 1/3, distribution (rate)", (double)c.bombHits / c.rolls,
+                     rateP(c.bombHits, c.rolls, 1.0 / 3.0));
+    printQualityLine("bomb 1/3, modulo (rate)", (double)c.bombModHits / c.rolls,
+                     rateP(c.bombModHits, c.rolls, 1.0 / 3.0));
+    printQualityLine("question 30%, distribution (rate)", (double)c.questionHits / c.rolls,
+                     rateP(c.questionHits, c.rolls, 0.3));
+    printQualityLine("question 30%, modulo (rate)", (double)c.questionModHits / c.rolls,
+                     rateP(c.questionModHits, c.rolls, 0.3));
+}
+
+/* 
+   Rules fuzzer.
+   Plays games with random and extreme rule settings (bomb always or
+   never exploding, bots that never or always question, 2-4 seats, a
+   human seat fed garbage-laden scripts) across pinned threads. The
+   per-turn invariants in Game (card conservation, hand size, bomb count
+   bounds) run on every turn, every deal is held to a memory budget,
+   every game must end with exactly one survivor, and a step watchdog
+   turns infinite loops into findings.
+   Offending tables dump their flight record to DIR when one is given.
+    */
+struct FuzzFinding {
+    string kind;
+    unsigned seed;
+    string setup;
+};
+
+static GameConfig fuzzConfig(mt19937& rng, unsigned seed, const string& dir, long maxSteps) {
+    auto pick = [&](int lo, int hi) { return uniform_int_distribution<int>(lo, hi)(rng); };
+    GameConfig cfg;
+    cfg.verbose = false;
+    cfg.seed = seed;
+    cfg.flightRecordDir = dir;
+    cfg.maxSteps = maxSteps;
+    cfg.humanSeat = pick(0, 9) == 0;
+    int seats = pick(2, 4);
+    cfg.numBots = seats - (cfg.humanSeat ? 1 : 0);
+
+    static constexpr int bombChoices[] = {1, 2, 3, 3, 3, 6, 1000};
+    cfg.bombOneIn = bombChoices[pick(0, 6)];
+    cfg.seatQuestionPercent.resize(seats);
+    for (int& pct : cfg.seatQuestionPercent) {
+        int r = pick(0, 9);
+        pct = r == 0 ? 0 : r == 1 ? 100 : r == 2 ? 1 : pick(0, 100);
+    }
+    // Game rejects three silent bots (they could never finish a round), so
+    // keep at most two and let every finding point at something new
+    int silent = 0;
+    for (int seat = cfg.humanSeat ? 1 : 0; seat < seats; ++seat)
+        if (cfg.seatQuestionPercent[seat] == 0 && ++silent > 2)
+            cfg.seatQuestionPercent[seat] = pick(1, 100);
+    // far above any table's peak, so only unbounded growth can trip it
+    cfg.memoryBudget = 64 * 1024;
+    if (pick(0, 3) == 0) cfg.firstPlayer = pick(0, seats - 1);
+    if (pick(0, 3) == 0) cfg.firstFocus = pick(0, Game::numFocusCards - 1);
+    return cfg;
+}
+
+static string describeConfig(const GameConfig& cfg) {
+    string s = to_string(cfg.numBots + (cfg.humanSeat ? 1 : 0)) + " seats"
+               + (cfg.humanSeat ? " (human)" : "") + ", bomb 1/" + to_string(cfg.bombOneIn)
+               + ", question%";
+    for (int pct : cfg.seatQuestionPercent) s += " " + to_string(pct);
+    return s;
+}
+
+static void runFuzz(long games, unsigned seed, int threads, const string& dir) {
+    const long maxSteps = 20000;
+    vector<vector<FuzzFinding>> findings(threads);
+    vector<long> played(threads, 0);
+    vector<thread> pool;
+    auto t0 = chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            pinToCpu(t);
+            mt19937 rng(seed + 7919u * t);
+            long share = games * (t + 1) / threads - games * t / threads;
+            for (long i = 0; i < share; ++i) {
+                GameConfig cfg = fuzzConfig(rng, (unsigned)rng(), dir, maxSteps);
+                QueueInput answers;
+                if (cfg.humanSeat) {
+                    answers = QueueInput(trainingScript(rng, 4000));
+                    cfg.input = &answers;
+                }
+                string kind;
+                try {
+                    Game game(cfg);
+                    GameResult res = game.play();
+                    unsigned alive = game.aliveMask();
+                    if (__builtin_popcount(alive) != 1 || res.winner != __builtin_ctz(alive | 1u << 31))
+                        kind = "no single winner";
+                } catch (const WatchdogTimeout&) {
+                    kind = "watchdog";
+                } catch (const InvariantViolation& e) {
+                    kind = string("invariant: ") + e.what();
+                } catch (const exception& e) {
+                    kind = string("exception: ") + e.what();
+                }
+                if (!kind.empty()) findings[t].push_back({kind, cfg.seed, describeConfig(cfg)});
+                played[t]++;
+            }
+        });
+    }
+    for (auto& th : pool) th.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    long total = 0;
+    map<string, long> byKind;
+    vector<FuzzFinding> all;
+    for (int t = 0; t < threads; ++t) {
+        total += played[t];
+        for (const auto& f : findings[t]) {
+            byKind[f.kind]++;
+            all.push_back(f);
+        }
+    }
+    printf("Fuzzed %ld games on %d thread(s) in %.2fs (%.0f games/s), watchdog %ld steps\n",
+           total, threads, secs, secs > 0 ? total / secs : 0.0, maxSteps);
+    if (all.empty()) {
+        cout << "No findings.\n";
+        return;
+    }
+    for (const auto& k : byKind) printf("  %6ld x %s\n", k.second, k.first.c_str());
+    cout << "First findings:\n";
+    for (size_t i = 0; i < all.size() && i < 10; ++i)
+        cout << "  " << all[i].kind << " | seed " << all[i].seed << " | " << all[i].setup << "\n";
+}
+
+/* 
+   SCRIPTED PLAY
+   --play saves the human's answers from a seeded interactive game;
+   --script feeds such a file back through the human seat, so the same
+   seed and answers reproduce the game without a console.
+    */
+static void runPlay(unsigned seed, const string& savePath) {
+    GameConfig cfg;
+    cfg.seed = seed;
+    cfg.flightRecordDir = ".";
+    StreamInput console(cin);
+    ofstream log;
+    unique_ptr<RecordingInput> recorder;
+    if (!savePath.empty()) {
+        log.open(savePath);
+        if (!log) throw runtime_error("Cannot write " + savePath);
+        recorder.reset(new RecordingInput(console, log));
+        cfg.input = recorder.get();
+    }
+    cout << "Seed " << seed << "\n";
+    Game game(cfg);
+    game.play();
+}
+
+static void runScript(const string& path, unsigned seed) {
+    FileInput answers(path);
+    GameConfig cfg;
+    cfg.seed = seed;
+    cfg.flightRecordDir = ".";
+    cfg.input = &answers;
+    Game game(cfg);
+    GameResult res = game.play();
+    cerr << "Script finished: winner seat " << res.winner << " after "
+         << res.rounds << " rounds\n";
+}
+
+static int usage(const char* prog) {
+    cerr << "Usage: " << prog << " [mode]\n"
+         << "  (no mode)            play interactively against 3 bots\n"
+         << "  --play SEED [FILE]   play interactively with a fixed seed, saving your\n"
+         << "                       answers to FILE\n"
+         << "  --script FILE SEED   replay the answers in FILE as the human seat\n"
+         << "  --stratified N       estimate seat win rates from N stratified bot games\n"
+         << "  --rare N EVENT [BOMB Q]\n"
+         << "                       importance-sampled estimate of EVENT (survivor|rout|marathon),\n"
+         << "                       optionally with proposal bomb/question probabilities\n"
+         << "  --duplicate N [P...] duplicate tournament over N deals between bots with\n"
+         << "                       question rates P (2-4 values, default 10 30 50 70)\n"
+         << "  --equity-table N FILE\n"
+         << "                       write the opening-hand equity table (N games per hand)\n"
+         << "  --macro N [K] [--validate]\n"
+         << "                       N games advanced a round at a time from K exact rounds\n"
+         << "                       per round state (default 2000); --validate compares\n"
+         << "                       against the per-turn engine\n"
+         << "  --bench FILE [REPS]  run the benchmark suite (default 15 reps), save JSON\n"
+         << "  --bench-compare BASE NEW\n"
+         << "                       report significant changes between two bench files\n"
+         << "  --scale N [THREADS]  scaling benchmark, N games per thread, up to THREADS\n"
+         << "                       threads (default: all hardware threads)\n"
+         << "  --train N [REF]      PGO training workload of N games, compared against REF:\n"
+         << "                       a --record file or \"key value\" rate lines\n"
+         << "  --record N FILE      play N bot games and write their records\n"
+         << "  --verify FILE [THREADS]\n"
+         << "                       re-execute every record and flag mismatches\n"
+         << "  --rng-quality N [ENGINE] [THREADS]\n"
+         << "                       statistical tests over N deals and rolls;\n"
+         << "                       ENGINE is stream (the game's, default), mt19937,\n"
+         << "                       minstd or rand\n"
+         << "  --fuzz N [THREADS] [DIR]\n"
+         << "                       fuzz the rules with N games; flight records of\n"
+         << "                       failing tables go to DIR\n";
+    return 1;
+}
+
+// Runs the mode named by argv[1]; returns the exit code
+static int runMode(int argc, char* argv[]) {
+    string mode = argv[1];
+    unsigned seed = random_device{}();
+    if (mode == "--play" && (argc == 3 || argc == 4)) {
+        runPlay((unsigned)strtoul(argv[2], nullptr, 10), argc == 4 ? argv[3] : "");
+        return 0;
+    }
+    if (mode == "--script" && argc == 4) {
+        runScript(argv[2], (unsigned)strtoul(argv[3], nullptr, 10));
+        return 0;
+    }
+    if (mode == "--stratified" && argc == 3 && parseCount(argv[2])) {
+        runStratified(parseCount(argv[2]), seed);
+        return 0;
+    }
+    if (mode == "--rare" && (argc == 4 || argc == 6) && parseCount(argv[2])) {
+        string event = argv[3];
+        if (event != "survivor" && event != "rout" && event != "marathon") return usage(argv[0]);
+        // defaults push the bomb toward the event; biasing the many question
+        // decisions per game costs effective sample size, so only marathon
+        // (which needs rounds that end without a question) does it
+        double bombQ = argc == 6 ? atof(argv[4])
+                     : event == "survivor" ? 0.25 : event == "rout" ? 0.8 : 0.1;
+        double questionQ = argc == 6 ? atof(argv[5]) : event == "marathon" ? 0.15 : 0.3;
+        runRareEvent(parseCount(argv[2]), seed, event, bombQ, questionQ);
+        return 0;
+    }
+    if (mode == "--duplicate" && argc >= 3 && parseCount(argv[2])) {
+        vector<int> profiles = {10, 30, 50, 70};
+        if (argc > 3) {
+            profiles.clear();
+            for (int i = 3; i < argc; ++i) profiles.push_back(atoi(argv[i]));
+        }
+        runDuplicate(parseCount(argv[2]), seed, profiles);
+        return 0;
+    }
+    if (mode == "--equity-table" && argc == 4 && parseCount(argv[2])) {
+        runEquityTable(parseCount(argv[2]), seed, argv[3]);
+        return 0;
+    }
+    if (mode == "--macro" && argc >= 3 && argc <= 5 && parseCount(argv[2])) {
+        long samples = 2000;
+        bool validate = false;
+        for (int i = 3; i < argc; ++i) {
+            if (string(argv[i]) == "--validate") validate = true;
+            else if (parseCount(argv[i])) samples = parseCount(argv[i]);
+            else return usage(argv[0]);
+        }
+        runMacro(parseCount(argv[2]), seed, samples, validate);
+        return 0;
+    }
+    if (mode == "--bench" && (argc == 3 || argc == 4)) {
+        int reps = argc == 4 ? (int)parseCount(argv[3]) : 15;
+        if (reps < 2) return usage(argv[0]);
+        runBench(argv[2], reps);
+        return 0;
+    }
+    if (mode == "--bench-compare" && argc == 4) {
+        runBenchCompare(argv[2], argv[3]);
+        return 0;
+    }
+    if (mode == "--scale" && (argc == 3 || argc == 4) && parseCount(argv[2])) {
+        int threads = argc == 4 ? (int)parseCount(argv[3])
+                                : (int)max(1u, thread::hardware_concurrency());
+        if (threads < 1) return usage(argv[0]);
+        runScale(parseCount(argv[2]), threads);
+        return 0;
+    }
+    if (mode == "--train" && (argc == 3 || argc == 4) && parseCount(argv[2])) {
+        runTraining(parseCount(argv[2]), 2024, argc == 4 ? argv[3] : "");
+        return 0;
+    }
+    if (mode == "--record" && argc == 4 && parseCount(argv[2])) {
+        runRecord(parseCount(argv[2]), seed, argv[3]);
+        return 0;
+    }
+    if (mode == "--verify" && (argc == 3 || argc == 4)) {
+        int threads = argc == 4 ? (int)parseCount(argv[3])
+                                : (int)max(1u, thread::hardware_concurrency());
+        if (threads < 1) return usage(argv[0]);
+        runVerify(argv[2], threads);
+        return 0;
+    }
+    if (mode == "--rng-quality" && argc >= 3 && argc <= 5 && parseCount(argv[2])) {
+        string engine = argc >= 4 ? argv[3] : "stream";
+        if (engine != "stream" && engine != "mt19937" && engine != "minstd" && engine != "rand")
+            return usage(argv[0]);
+        int threads = argc == 5 ? (int)parseCount(argv[4])
+                                : (int)max(1u, thread::hardware_concurrency());
+        if (threads < 1) return usage(argv[0]);
+        runRngQuality(parseCount(argv[2]), engine, threads);
+        return 0;
+    }
+    if (mode == "--fuzz" && argc >= 3 && argc <= 5 && parseCount(argv[2])) {
+        int threads = argc >= 4 ? (int)parseCount(argv[3])
+                                : (int)max(1u, thread::hardware_concurrency());
+        if (threads < 1) return usage(argv[0]);
+        runFuzz(parseCount(argv[2]), seed, threads, argc == 5 ? argv[4] : "");
+        return 0;
+    }
+    return usage(argv[0]);
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc > 1) return runMode(argc, argv);
+
+        GameConfig cfg;
+        cfg.seed = random_device{}() ^ (unsigned)time(nullptr);
+        cfg.flightRecordDir = ".";
+        Game game(cfg);
+        game.play();
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
     return 0;
 }
+#endif